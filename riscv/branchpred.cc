@@ -0,0 +1,355 @@
+// See LICENSE for license details.
+
+#include "branchpred.h"
+#include "processor.h"
+#include <cstdlib>
+#include <cstring>
+#include <cinttypes>
+#include <cstdio>
+#include <iostream>
+#include <algorithm>
+
+static bool is_link_reg(reg_t r)
+{
+  return r == 1 || r == 5;
+}
+
+void trace_branch(processor_t* p, insn_bits_t opc, insn_t insn, reg_t pc, reg_t npc)
+{
+  int length = insn_length(opc);
+  branch_type_t type;
+
+  if (opc == MATCH_JAL) {
+    type = is_link_reg(insn.rd()) ? BRANCH_CALL : BRANCH_JUMP;
+  } else if (opc == MATCH_JALR) {
+    if (is_link_reg(insn.rd()))
+      type = BRANCH_CALL;
+    else if (is_link_reg(insn.rs1()))
+      type = BRANCH_RETURN;
+    else
+      type = BRANCH_INDIRECT;
+  } else if (opc == MATCH_C_J) {
+    type = BRANCH_JUMP;
+  } else if (opc == MATCH_C_JAL) {
+    if (npc == pc + 2)
+      return; // c.addiw shares the encoding on RV64
+    type = BRANCH_CALL;
+  } else if (opc == MATCH_C_JR || opc == MATCH_C_JALR) {
+    if (insn.rvc_rs2() != 0)
+      return; // c.mv or c.add
+    if (opc == MATCH_C_JALR)
+      type = BRANCH_CALL;
+    else if (is_link_reg(insn.rvc_rs1()))
+      type = BRANCH_RETURN;
+    else
+      type = BRANCH_INDIRECT;
+  } else {
+    type = BRANCH_COND;
+  }
+
+  bool taken = type != BRANCH_COND || npc != pc + length;
+  p->get_branch_tracer()->branch(p, pc, npc, taken, type, length);
+}
+
+bimodal_predictor_t::bimodal_predictor_t(size_t index_bits)
+  : counters(size_t(1) << index_bits, 1)
+{
+}
+
+bool bimodal_predictor_t::predict(reg_t pc)
+{
+  return counters[(pc >> 1) & (counters.size()-1)] >= 2;
+}
+
+void bimodal_predictor_t::update(reg_t pc, bool taken)
+{
+  uint8_t& c = counters[(pc >> 1) & (counters.size()-1)];
+  if (taken && c < 3)
+    c++;
+  else if (!taken && c > 0)
+    c--;
+}
+
+gshare_predictor_t::gshare_predictor_t(size_t index_bits)
+  : counters(size_t(1) << index_bits, 1), history(0)
+{
+}
+
+bool gshare_predictor_t::predict(reg_t pc)
+{
+  return counters[index(pc)] >= 2;
+}
+
+void gshare_predictor_t::update(reg_t pc, bool taken)
+{
+  uint8_t& c = counters[index(pc)];
+  if (taken && c < 3)
+    c++;
+  else if (!taken && c > 0)
+    c--;
+  history = (history << 1) | taken;
+}
+
+void tage_predictor_t::folded_t::update(const uint8_t* hist, size_t head)
+{
+  // shift in the newest bit and cancel the one that just left the window
+  value = (value << 1) | hist[head];
+  value ^= hist[(head + len) % MAX_HISTORY] << (len % width);
+  value ^= value >> width;
+  value &= (1u << width) - 1;
+}
+
+tage_predictor_t::tage_predictor_t(size_t index_bits)
+  : base(size_t(1) << index_bits, 1), head(0), branches(0), provider(-1)
+{
+  static const size_t lengths[TABLES] = {5, 15, 44, 130};
+  size_t table_bits = index_bits > 6 ? index_bits - 2 : 4;
+
+  memset(history, 0, sizeof(history));
+  for (size_t t = 0; t < TABLES; t++) {
+    table_t& tab = tables[t];
+    tab.entries.resize(size_t(1) << table_bits, entry_t{0, 0, 0});
+    tab.history_len = lengths[t];
+    tab.index_hist = folded_t{0, lengths[t], table_bits};
+    tab.tag_hist[0] = folded_t{0, lengths[t], TAG_BITS};
+    tab.tag_hist[1] = folded_t{0, lengths[t], TAG_BITS - 1};
+  }
+}
+
+size_t tage_predictor_t::index(size_t t, reg_t pc)
+{
+  const table_t& tab = tables[t];
+  size_t bits = tab.index_hist.width;
+  return ((pc >> 1) ^ (pc >> (bits + 1)) ^ tab.index_hist.value) & ((size_t(1) << bits) - 1);
+}
+
+uint16_t tage_predictor_t::compute_tag(size_t t, reg_t pc)
+{
+  const table_t& tab = tables[t];
+  return ((pc >> 1) ^ tab.tag_hist[0].value ^ (tab.tag_hist[1].value << 1)) &
+         ((1u << TAG_BITS) - 1);
+}
+
+bool tage_predictor_t::predict(reg_t pc)
+{
+  bool base_pred = base[(pc >> 1) & (base.size()-1)] >= 2;
+  int alt = -1;
+  provider = -1;
+  for (int t = TABLES-1; t >= 0; t--) {
+    indices[t] = index(t, pc);
+    tags[t] = compute_tag(t, pc);
+    if (tables[t].entries[indices[t]].tag != tags[t])
+      continue;
+    if (provider < 0)
+      provider = t;
+    else if (alt < 0)
+      alt = t;
+  }
+
+  alt_pred = alt >= 0 ? tables[alt].entries[indices[alt]].ctr >= 0 : base_pred;
+  provider_pred = provider >= 0 ? tables[provider].entries[indices[provider]].ctr >= 0 : base_pred;
+  return provider_pred;
+}
+
+void tage_predictor_t::update(reg_t pc, bool taken)
+{
+  if (provider >= 0) {
+    entry_t& e = tables[provider].entries[indices[provider]];
+    if (provider_pred != alt_pred) {
+      if (provider_pred == taken && e.useful < 3)
+        e.useful++;
+      else if (provider_pred != taken && e.useful > 0)
+        e.useful--;
+    }
+    if (taken && e.ctr < 3)
+      e.ctr++;
+    else if (!taken && e.ctr > -4)
+      e.ctr--;
+  } else {
+    uint8_t& c = base[(pc >> 1) & (base.size()-1)];
+    if (taken && c < 3)
+      c++;
+    else if (!taken && c > 0)
+      c--;
+  }
+
+  // on a mispredict, try to give the branch an entry with a longer history
+  if (provider_pred != taken && provider < int(TABLES-1)) {
+    bool allocated = false;
+    for (size_t t = provider + 1; t < TABLES && !allocated; t++) {
+      entry_t& e = tables[t].entries[indices[t]];
+      if (e.useful == 0) {
+        e = entry_t{int8_t(taken ? 0 : -1), tags[t], 0};
+        allocated = true;
+      }
+    }
+    for (size_t t = provider + 1; t < TABLES && !allocated; t++) {
+      entry_t& e = tables[t].entries[indices[t]];
+      if (e.useful > 0)
+        e.useful--;
+    }
+  }
+
+  // age the useful bits now and then so stale entries can be replaced
+  if (++branches % (256 * 1024) == 0)
+    for (auto& tab : tables)
+      for (auto& e : tab.entries)
+        e.useful >>= 1;
+
+  head = (head + MAX_HISTORY - 1) % MAX_HISTORY;
+  history[head] = taken;
+  for (auto& tab : tables) {
+    tab.index_hist.update(history, head);
+    tab.tag_hist[0].update(history, head);
+    tab.tag_hist[1].update(history, head);
+  }
+}
+
+btb_t::btb_t(size_t nentries)
+  : entries(std::max(nentries, size_t(WAYS)) / WAYS * WAYS, entry_t{0, 0, 0}), now(0)
+{
+}
+
+reg_t btb_t::lookup(reg_t pc)
+{
+  entry_t* set = &entries[(pc >> 1) % (entries.size() / WAYS) * WAYS];
+  for (size_t i = 0; i < WAYS; i++) {
+    if (set[i].pc == pc) {
+      set[i].last_use = ++now;
+      return set[i].target;
+    }
+  }
+  return 0;
+}
+
+void btb_t::update(reg_t pc, reg_t target)
+{
+  entry_t* set = &entries[(pc >> 1) % (entries.size() / WAYS) * WAYS];
+  entry_t* victim = &set[0];
+  for (size_t i = 0; i < WAYS; i++) {
+    if (set[i].pc == pc) {
+      victim = &set[i];
+      break;
+    }
+    if (set[i].last_use < victim->last_use)
+      victim = &set[i];
+  }
+  *victim = entry_t{pc, target, ++now};
+}
+
+void ras_t::push(reg_t addr)
+{
+  top = (top + 1) % stack.size();
+  stack[top] = addr;
+  size = std::min(size + 1, stack.size());
+}
+
+reg_t ras_t::pop()
+{
+  if (size == 0)
+    return 0;
+  reg_t addr = stack[top];
+  top = (top + stack.size() - 1) % stack.size();
+  size--;
+  return addr;
+}
+
+static void help()
+{
+  std::cerr << "Branch predictor configurations must be of the form" << std::endl;
+  std::cerr << "  kind[:bits[:btb[:ras]]]" << std::endl;
+  std::cerr << "where kind is bimodal, gshare or tage, bits (from 4 to 24) sizes" << std::endl;
+  std::cerr << "the direction tables, and btb and ras are the number of entries" << std::endl;
+  std::cerr << "in the branch target buffer and return-address stack." << std::endl;
+  exit(1);
+}
+
+branch_predictor_t::branch_predictor_t(const char* cfg, size_t nprocs)
+  : harts(nprocs)
+{
+  const char* colon = strchr(cfg, ':');
+  std::string kind(cfg, colon ? colon : cfg + strlen(cfg));
+  size_t args[3] = {12, 512, 16};
+  for (size_t i = 0; colon && i < 3; i++) {
+    args[i] = atoi(colon + 1);
+    colon = strchr(colon + 1, ':');
+  }
+  if (colon || args[0] < 4 || args[0] > 24 || args[1] == 0 || args[2] == 0)
+    help();
+  if (kind != "bimodal" && kind != "gshare" && kind != "tage")
+    help();
+
+  config = kind + ":" + std::to_string(args[0]) + ", " +
+           std::to_string(args[1]) + "-entry BTB, " +
+           std::to_string(args[2]) + "-entry RAS";
+  for (auto& h : harts) {
+    if (kind == "bimodal")
+      h.direction.reset(new bimodal_predictor_t(args[0]));
+    else if (kind == "gshare")
+      h.direction.reset(new gshare_predictor_t(args[0]));
+    else
+      h.direction.reset(new tage_predictor_t(args[0]));
+    h.btb.reset(new btb_t(args[1]));
+    h.ras.reset(new ras_t(args[2]));
+    h.proc = NULL;
+    memset(h.branches, 0, sizeof(h.branches));
+    memset(h.mispredicts, 0, sizeof(h.mispredicts));
+  }
+}
+
+void branch_predictor_t::branch(processor_t* p, reg_t pc, reg_t target, bool taken,
+                                branch_type_t type, int length)
+{
+  hart_t& h = harts[p->get_id()];
+  h.proc = p;
+  h.branches[type]++;
+
+  bool mispredict;
+  if (type == BRANCH_COND) {
+    bool predicted = h.direction->predict(pc);
+    h.direction->update(pc, taken);
+    mispredict = predicted != taken || (taken && h.btb->lookup(pc) != target);
+    if (taken)
+      h.btb->update(pc, target);
+  } else if (type == BRANCH_RETURN) {
+    mispredict = h.ras->pop() != target;
+  } else {
+    if (type == BRANCH_CALL)
+      h.ras->push(pc + length);
+    mispredict = h.btb->lookup(pc) != target;
+    h.btb->update(pc, target);
+  }
+  h.mispredicts[type] += mispredict;
+}
+
+void branch_predictor_t::print_stats()
+{
+  static const char* names[] = {"conditional", "jump", "call", "return", "indirect"};
+
+  for (size_t i = 0; i < harts.size(); i++) {
+    hart_t& h = harts[i];
+    if (!h.proc)
+      continue;
+    double kinsns = h.proc->get_event_count(HPM_INSTRET) / 1000.0;
+    uint64_t branches = 0, mispredicts = 0;
+
+    printf("core %zu branch predictor (%s)\n", i, config.c_str());
+    printf("  %-12s %14s %14s %8s\n", "type", "count", "mispredicts", "MPKI");
+    for (int t = BRANCH_COND; t <= BRANCH_INDIRECT; t++) {
+      printf("  %-12s %14" PRIu64 " %14" PRIu64 " %8.3f\n", names[t],
+             h.branches[t], h.mispredicts[t], h.mispredicts[t] / kinsns);
+      branches += h.branches[t];
+      mispredicts += h.mispredicts[t];
+    }
+    printf("  %-12s %14" PRIu64 " %14" PRIu64 " %8.3f\n", "total",
+           branches, mispredicts, mispredicts / kinsns);
+  }
+}
+
+uint64_t branch_predictor_t::get_mispredicts(size_t hart)
+{
+  uint64_t n = 0;
+  for (int t = BRANCH_COND; t <= BRANCH_INDIRECT; t++)
+    n += harts[hart].mispredicts[t];
+  return n;
+}
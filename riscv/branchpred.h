@@ -0,0 +1,186 @@
+// See LICENSE for license details.
+
+#ifndef _RISCV_BRANCH_PRED_H
+#define _RISCV_BRANCH_PRED_H
+
+#include "decode.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+class processor_t;
+
+enum branch_type_t {
+  BRANCH_COND,     // conditional branch
+  BRANCH_JUMP,     // direct jump that doesn't link
+  BRANCH_CALL,     // jump that links
+  BRANCH_RETURN,   // indirect jump through a link register
+  BRANCH_INDIRECT, // any other indirect jump
+};
+
+// Sees every control transfer a hart retires (see trace_opcode).
+class branch_tracer_t
+{
+ public:
+  virtual ~branch_tracer_t() {}
+  // target is the next pc, whether or not the branch was taken
+  virtual void branch(processor_t* p, reg_t pc, reg_t target, bool taken,
+                      branch_type_t type, int length) = 0;
+};
+
+// classify the jump or branch the handler for opc just executed
+void trace_branch(processor_t* p, insn_bits_t opc, insn_t insn, reg_t pc, reg_t npc);
+
+// A conditional branch direction predictor.  update is called for the
+// same pc right after predict.
+class direction_predictor_t
+{
+ public:
+  virtual ~direction_predictor_t() {}
+  virtual bool predict(reg_t pc) = 0;
+  virtual void update(reg_t pc, bool taken) = 0;
+};
+
+class bimodal_predictor_t : public direction_predictor_t
+{
+ public:
+  bimodal_predictor_t(size_t index_bits);
+  bool predict(reg_t pc);
+  void update(reg_t pc, bool taken);
+
+ private:
+  std::vector<uint8_t> counters;
+};
+
+class gshare_predictor_t : public direction_predictor_t
+{
+ public:
+  gshare_predictor_t(size_t index_bits);
+  bool predict(reg_t pc);
+  void update(reg_t pc, bool taken);
+
+ private:
+  size_t index(reg_t pc) { return ((pc >> 1) ^ history) & (counters.size()-1); }
+  std::vector<uint8_t> counters;
+  uint64_t history;
+};
+
+// A small TAGE: a bimodal base predictor and four tagged tables indexed by
+// geometrically longer global histories, folded incrementally.
+class tage_predictor_t : public direction_predictor_t
+{
+ public:
+  tage_predictor_t(size_t index_bits);
+  bool predict(reg_t pc);
+  void update(reg_t pc, bool taken);
+
+ private:
+  static const size_t TABLES = 4;
+  static const size_t TAG_BITS = 9;
+  static const size_t MAX_HISTORY = 256;
+
+  struct entry_t
+  {
+    int8_t ctr; // -4..3, taken if >= 0
+    uint16_t tag;
+    uint8_t useful;
+  };
+
+  // a history of length len folded down to width bits
+  struct folded_t
+  {
+    uint32_t value;
+    size_t len;
+    size_t width;
+    void update(const uint8_t* hist, size_t head);
+  };
+
+  struct table_t
+  {
+    std::vector<entry_t> entries;
+    size_t history_len;
+    folded_t index_hist;
+    folded_t tag_hist[2];
+  };
+
+  size_t index(size_t t, reg_t pc);
+  uint16_t compute_tag(size_t t, reg_t pc);
+
+  std::vector<uint8_t> base;
+  table_t tables[TABLES];
+  uint8_t history[MAX_HISTORY];
+  size_t head;
+  uint64_t branches;
+
+  // from the last predict
+  size_t indices[TABLES];
+  uint16_t tags[TABLES];
+  int provider; // longest matching table, or -1 for the base predictor
+  bool provider_pred;
+  bool alt_pred;
+};
+
+// A 4-way set-associative branch target buffer with LRU replacement.
+class btb_t
+{
+ public:
+  btb_t(size_t entries);
+  // the predicted target, or 0 if pc isn't in the buffer
+  reg_t lookup(reg_t pc);
+  void update(reg_t pc, reg_t target);
+
+ private:
+  static const size_t WAYS = 4;
+  struct entry_t
+  {
+    reg_t pc;
+    reg_t target;
+    uint64_t last_use;
+  };
+  std::vector<entry_t> entries;
+  uint64_t now;
+};
+
+// A return-address stack that overwrites its oldest entry when full.
+class ras_t
+{
+ public:
+  ras_t(size_t depth) : stack(depth), top(0), size(0) {}
+  void push(reg_t addr);
+  reg_t pop();
+
+ private:
+  std::vector<reg_t> stack;
+  size_t top;
+  size_t size;
+};
+
+// Direction predictor, BTB and RAS for each hart, with mispredicts per
+// thousand instructions.
+class branch_predictor_t : public branch_tracer_t
+{
+ public:
+  // config is kind[:index bits[:BTB entries[:RAS depth]]], with kind one
+  // of bimodal, gshare or tage
+  branch_predictor_t(const char* config, size_t nprocs);
+  void branch(processor_t* p, reg_t pc, reg_t target, bool taken,
+              branch_type_t type, int length);
+  // one table per hart, to stdout
+  void print_stats();
+  uint64_t get_mispredicts(size_t hart);
+
+ private:
+  struct hart_t
+  {
+    std::unique_ptr<direction_predictor_t> direction;
+    std::unique_ptr<btb_t> btb;
+    std::unique_ptr<ras_t> ras;
+    processor_t* proc;
+    uint64_t branches[BRANCH_INDIRECT + 1];
+    uint64_t mispredicts[BRANCH_INDIRECT + 1];
+  };
+  std::string config;
+  std::vector<hart_t> harts;
+};
+
+#endif
@@ -5,11 +5,19 @@
 #include <cstdlib>
 #include <iostream>
 #include <iomanip>
+#include <chrono>
 
 cache_sim_t::cache_sim_t(size_t _sets, size_t _ways, size_t _linesz, const char* _name)
  : sets(_sets), ways(_ways), linesz(_linesz), name(_name)
 {
-  init();
+  init(true);
+}
+
+cache_sim_t::cache_sim_t(size_t _sets, size_t _ways, size_t _linesz, const char* _name,
+                         bool alloc_tags)
+ : sets(_sets), ways(_ways), linesz(_linesz), name(_name)
+{
+  init(alloc_tags);
 }
 
 static void help()
@@ -18,10 +26,11 @@ static void help()
   std::cerr << "  sets:ways:blocksize" << std::endl;
   std::cerr << "where sets, ways, and blocksize are positive integers, with" << std::endl;
   std::cerr << "sets and blocksize both powers of two and blocksize at least 8." << std::endl;
+  std::cerr << "Sharded caches need at least as many sets as threads." << std::endl;
   exit(1);
 }
 
-cache_sim_t* cache_sim_t::construct(const char* config, const char* name)
+cache_sim_t* cache_sim_t::construct(const char* config, const char* name, size_t shards)
 {
   const char* wp = strchr(config, ':');
   if (!wp++) help();
@@ -32,12 +41,18 @@ cache_sim_t* cache_sim_t::construct(const char* config, const char* name)
   size_t ways = atoi(std::string(wp, bp).c_str());
   size_t linesz = atoi(bp);
 
+  if (shards > 1)
+  {
+    if (shards > sets || (shards & (shards-1)))
+      help();
+    return new sharded_cache_sim_t(sets, ways, linesz, name, shards);
+  }
   if (ways > 4 /* empirical */ && sets == 1)
     return new fa_cache_sim_t(ways, linesz, name);
   return new cache_sim_t(sets, ways, linesz, name);
 }
 
-void cache_sim_t::init()
+void cache_sim_t::init(bool alloc_tags)
 {
   if(sets == 0 || (sets & (sets-1)))
     help();
@@ -48,7 +63,7 @@ void cache_sim_t::init()
   for (size_t x = linesz; x>1; x >>= 1)
     idx_shift++;
 
-  tags = new uint64_t[sets*ways]();
+  tags = alloc_tags ? new uint64_t[sets*ways]() : NULL;
   read_accesses = 0;
   read_misses = 0;
   bytes_read = 0;
@@ -56,12 +71,17 @@ void cache_sim_t::init()
   write_misses = 0;
   bytes_written = 0;
   writebacks = 0;
+  prefetches_issued = 0;
+  prefetches_useful = 0;
+  prefetches_late = 0;
+  prefetches_polluting = 0;
 
   miss_handler = NULL;
+  prefetcher = NULL;
 }
 
 cache_sim_t::cache_sim_t(const cache_sim_t& rhs)
- : sets(rhs.sets), ways(rhs.ways), linesz(rhs.linesz),
+ : prefetcher(NULL), sets(rhs.sets), ways(rhs.ways), linesz(rhs.linesz),
    idx_shift(rhs.idx_shift), name(rhs.name)
 {
   tags = new uint64_t[sets*ways];
@@ -72,6 +92,7 @@ cache_sim_t::~cache_sim_t()
 {
   print_stats();
   delete [] tags;
+  delete prefetcher;
 }
 
 void cache_sim_t::print_stats()
@@ -98,6 +119,19 @@ void cache_sim_t::print_stats()
   std::cout << "Writebacks:            " << writebacks << std::endl;
   std::cout << name << " ";
   std::cout << "Miss Rate:             " << mr << '%' << std::endl;
+
+  if (prefetches_issued == 0)
+    return;
+  std::cout << name << " ";
+  std::cout << "Prefetches Issued:     " << prefetches_issued << std::endl;
+  std::cout << name << " ";
+  std::cout << "Prefetches Useful:     " << prefetches_useful << std::endl;
+  std::cout << name << " ";
+  std::cout << "Prefetches Late:       " << prefetches_late << std::endl;
+  std::cout << name << " ";
+  std::cout << "Prefetches Polluting:  " << prefetches_polluting << std::endl;
+  std::cout << name << " ";
+  std::cout << "Prefetch Accuracy:     " << 100.0f*prefetches_useful/prefetches_issued << '%' << std::endl;
 }
 
 uint64_t* cache_sim_t::check_tag(uint64_t addr)
@@ -106,7 +140,7 @@ uint64_t* cache_sim_t::check_tag(uint64_t addr)
   size_t tag = (addr >> idx_shift) | VALID;
 
   for (size_t i = 0; i < ways; i++)
-    if (tag == (tags[idx*ways + i] & ~DIRTY))
+    if (tag == (tags[idx*ways + i] & ~(DIRTY | PREFETCHED)))
       return &tags[idx*ways + i];
 
   return NULL;
@@ -121,7 +155,7 @@ uint64_t cache_sim_t::victimize(uint64_t addr)
   return victim;
 }
 
-void cache_sim_t::access(uint64_t addr, size_t bytes, bool store)
+void cache_sim_t::access(uint64_t addr, size_t bytes, bool store, uint64_t pc)
 {
   store ? write_accesses++ : read_accesses++;
   (store ? bytes_written : bytes_read) += bytes;
@@ -131,26 +165,106 @@ void cache_sim_t::access(uint64_t addr, size_t bytes, bool store)
   {
     if (store)
       *hit_way |= DIRTY;
+    if (unlikely(*hit_way & PREFETCHED))
+    {
+      *hit_way &= ~PREFETCHED;
+      uint64_t line = addr >> idx_shift;
+      prefetch_used(line, prefetch_issued[line]);
+      prefetch_issued.erase(line);
+      prefetch(addr, pc, true);
+    }
+    else if (prefetcher)
+      prefetch(addr, pc, false);
     return;
   }
 
-  store ? write_misses++ : read_misses++;
+  // a miss that hits in the prefetcher's own buffer costs no refill
+  uint64_t line = addr >> idx_shift, issued;
+  if (prefetcher && prefetcher->has_buffer() &&
+      prefetcher->take(line, read_accesses + write_accesses, issued, prefetch_lines))
+  {
+    prefetch_used(line, issued);
+    evict(victimize(addr), pc);
+  }
+  else
+  {
+    store ? write_misses++ : read_misses++;
+
+    if (!pollution_filter.empty())
+    {
+      uint64_t& evicted = pollution_filter[line % pollution_filter.size()];
+      if (evicted == (line | VALID))
+      {
+        prefetches_polluting++;
+        evicted = 0;
+      }
+    }
+
+    evict(victimize(addr), pc);
+
+    if (miss_handler)
+      miss_handler->access(addr & ~(linesz-1), linesz, false, pc);
+  }
+
+  if (store)
+    *check_tag(addr) |= DIRTY;
 
-  uint64_t victim = victimize(addr);
+  if (prefetcher)
+    prefetch(addr, pc, true);
+}
+
+void cache_sim_t::evict(uint64_t victim, uint64_t pc)
+{
+  if (unlikely(victim & PREFETCHED))
+    prefetch_issued.erase((victim & ~(VALID | DIRTY | PREFETCHED)));
 
   if ((victim & (VALID | DIRTY)) == (VALID | DIRTY))
   {
-    uint64_t dirty_addr = (victim & ~(VALID | DIRTY)) << idx_shift;
+    uint64_t dirty_addr = (victim & ~(VALID | DIRTY | PREFETCHED)) << idx_shift;
     if (miss_handler)
-      miss_handler->access(dirty_addr, linesz, true);
+      miss_handler->access(dirty_addr, linesz, true, pc);
     writebacks++;
   }
+}
 
-  if (miss_handler)
-    miss_handler->access(addr & ~(linesz-1), linesz, false);
+void cache_sim_t::prefetch(uint64_t addr, uint64_t pc, bool trigger)
+{
+  uint64_t now = read_accesses + write_accesses;
+  prefetcher->access(addr, pc, trigger, now, prefetch_lines);
 
-  if (store)
-    *check_tag(addr) |= DIRTY;
+  for (auto line : prefetch_lines)
+  {
+    uint64_t line_addr = line << idx_shift;
+    if (check_tag(line_addr))
+      continue;
+    prefetches_issued++;
+
+    if (!prefetcher->has_buffer())
+    {
+      uint64_t victim = victimize(line_addr);
+      if ((victim & (VALID | PREFETCHED)) == VALID)
+      {
+        if (pollution_filter.empty())
+          pollution_filter.resize(sets * ways);
+        uint64_t victim_line = victim & ~(VALID | DIRTY);
+        pollution_filter[victim_line % pollution_filter.size()] = victim_line | VALID;
+      }
+      evict(victim, pc);
+      *check_tag(line_addr) |= PREFETCHED;
+      prefetch_issued[line] = now;
+    }
+
+    if (miss_handler)
+      miss_handler->access(line_addr, linesz, false, pc);
+  }
+  prefetch_lines.clear();
+}
+
+void cache_sim_t::prefetch_used(uint64_t line, uint64_t issued)
+{
+  prefetches_useful++;
+  if (read_accesses + write_accesses - issued <= PREFETCH_LATENCY)
+    prefetches_late++;
 }
 
 fa_cache_sim_t::fa_cache_sim_t(size_t ways, size_t linesz, const char* name)
@@ -177,3 +291,103 @@ uint64_t fa_cache_sim_t::victimize(uint64_t addr)
   tags[addr >> idx_shift] = (addr >> idx_shift) | VALID;
   return old_tag;
 }
+
+sharded_cache_sim_t::sharded_cache_sim_t(size_t sets, size_t ways, size_t linesz,
+                                         const char* name, size_t nshards)
+  : cache_sim_t(sets, ways, linesz, name, false), shard_shift(0), stop(false)
+{
+  for (size_t x = nshards; x > 1; x >>= 1)
+    shard_shift++;
+
+  // a shard holds the sets whose low index bits are its number, and sees
+  // addresses with those bits removed, so its own indexing lines up
+  for (size_t i = 0; i < nshards; i++)
+  {
+    shard_t* s = new shard_t;
+    s->cache = new cache_sim_t(sets >> shard_shift, ways, linesz, name);
+    s->pending = 0;
+    s->head = 0;
+    s->tail = 0;
+    shards.push_back(s);
+  }
+  for (auto s : shards)
+    s->worker = std::thread(&sharded_cache_sim_t::run, this, s);
+}
+
+sharded_cache_sim_t::~sharded_cache_sim_t()
+{
+  for (auto s : shards)
+    publish(s);
+  stop = true;
+
+  for (auto s : shards)
+  {
+    s->worker.join();
+    cache_sim_t* c = s->cache;
+    read_accesses += c->read_accesses;
+    read_misses += c->read_misses;
+    bytes_read += c->bytes_read;
+    write_accesses += c->write_accesses;
+    write_misses += c->write_misses;
+    bytes_written += c->bytes_written;
+    writebacks += c->writebacks;
+    c->read_accesses = c->write_accesses = 0; // don't print them twice
+    delete c;
+    delete s;
+  }
+}
+
+void sharded_cache_sim_t::access(uint64_t addr, size_t bytes, bool store, uint64_t pc)
+{
+  uint64_t line = addr >> idx_shift;
+  shard_t* s = shards[line & (shards.size()-1)];
+
+  while (s->pending - s->tail.load(std::memory_order_acquire) == QUEUE_SIZE)
+  {
+    publish(s);
+    std::this_thread::yield();
+  }
+
+  record_t& r = s->queue[s->pending++ % QUEUE_SIZE];
+  r.addr = ((line >> shard_shift) << idx_shift) | (addr & (linesz-1));
+  r.bytes = bytes;
+  r.store = store;
+
+  if (s->pending % BATCH == 0)
+    publish(s);
+}
+
+void sharded_cache_sim_t::publish(shard_t* s)
+{
+  s->head.store(s->pending, std::memory_order_release);
+}
+
+void sharded_cache_sim_t::run(shard_t* s)
+{
+  size_t tail = 0;
+  size_t idle = 0;
+  while (true)
+  {
+    bool stopping = stop.load(std::memory_order_acquire);
+    size_t head = s->head.load(std::memory_order_acquire);
+    if (head == tail)
+    {
+      if (stopping)
+        return;
+      // back off to sleeping so an idle model doesn't steal a host core
+      if (++idle < 1024)
+        std::this_thread::yield();
+      else
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      continue;
+    }
+
+    idle = 0;
+    for (; tail != head; tail++)
+    {
+      record_t& r = s->queue[tail % QUEUE_SIZE];
+      s->cache->access(r.addr, r.bytes, r.store);
+    }
+    s->tail.store(tail, std::memory_order_release);
+  }
+}
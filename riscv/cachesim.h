@@ -4,10 +4,15 @@
 #define _RISCV_CACHE_SIM_H
 
 #include "memtracer.h"
+#include "prefetcher.h"
 #include <cstring>
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <cstdint>
+#include <vector>
+#include <atomic>
+#include <thread>
 
 class lfsr_t
 {
@@ -26,21 +31,48 @@ class cache_sim_t
   cache_sim_t(const cache_sim_t& rhs);
   virtual ~cache_sim_t();
 
-  void access(uint64_t addr, size_t bytes, bool store);
+  // pc is the instruction making the access, if known, for prefetchers
+  virtual void access(uint64_t addr, size_t bytes, bool store, uint64_t pc = 0);
   void print_stats();
+  uint64_t get_misses() { return read_misses + write_misses; }
   void set_miss_handler(cache_sim_t* mh) { miss_handler = mh; }
+  // see prefetcher_t::construct for the configurations
+  void set_prefetcher(const char* config)
+  {
+    delete prefetcher;
+    prefetcher = prefetcher_t::construct(config, linesz);
+  }
 
-  static cache_sim_t* construct(const char* config, const char* name);
+  // with shards > 1, the sets are split across that many threads
+  static cache_sim_t* construct(const char* config, const char* name,
+                                size_t shards = 1);
 
  protected:
   static const uint64_t VALID = 1ULL << 63;
   static const uint64_t DIRTY = 1ULL << 62;
+  static const uint64_t PREFETCHED = 1ULL << 61; // and not used yet
+  // a prefetched line used within this many accesses arrived late
+  static const uint64_t PREFETCH_LATENCY = 16;
+
+  // for models that keep their tags elsewhere: no tag array is allocated
+  cache_sim_t(size_t sets, size_t ways, size_t linesz, const char* name,
+              bool alloc_tags);
 
   virtual uint64_t* check_tag(uint64_t addr);
   virtual uint64_t victimize(uint64_t addr);
 
+  void evict(uint64_t victim, uint64_t pc);
+  void prefetch(uint64_t addr, uint64_t pc, bool trigger);
+  void prefetch_used(uint64_t line, uint64_t issued);
+
   lfsr_t lfsr;
   cache_sim_t* miss_handler;
+  prefetcher_t* prefetcher;
+  std::vector<uint64_t> prefetch_lines;
+  // when each prefetched line still in the cache was fetched
+  std::unordered_map<uint64_t, uint64_t> prefetch_issued;
+  // lines evicted by prefetches, so a demand miss on one counts as pollution
+  std::vector<uint64_t> pollution_filter;
 
   size_t sets;
   size_t ways;
@@ -56,10 +88,16 @@ class cache_sim_t
   uint64_t write_misses;
   uint64_t bytes_written;
   uint64_t writebacks;
+  uint64_t prefetches_issued;
+  uint64_t prefetches_useful;
+  uint64_t prefetches_late;
+  uint64_t prefetches_polluting;
 
   std::string name;
 
-  void init();
+  void init(bool alloc_tags);
+
+  friend class sharded_cache_sim_t;
 };
 
 class fa_cache_sim_t : public cache_sim_t
@@ -73,6 +111,51 @@ class fa_cache_sim_t : public cache_sim_t
   std::map<uint64_t, uint64_t> tags;
 };
 
+// A cache whose sets are split across worker threads.  Each access is
+// queued to the thread that owns its set, so every set still sees its
+// accesses in order, and the statistics are merged when the model is
+// destroyed.  It has no miss handler, so it only models the last level,
+// and get_misses() doesn't count anything while it runs.
+class sharded_cache_sim_t : public cache_sim_t
+{
+ public:
+  sharded_cache_sim_t(size_t sets, size_t ways, size_t linesz,
+                      const char* name, size_t shards);
+  ~sharded_cache_sim_t();
+  void access(uint64_t addr, size_t bytes, bool store, uint64_t pc = 0);
+
+ private:
+  static const size_t QUEUE_SIZE = 4096;
+  static const size_t BATCH = 64;
+
+  struct record_t
+  {
+    uint64_t addr;
+    uint32_t bytes;
+    bool store;
+  };
+
+  // a single-producer, single-consumer ring; the simulator publishes head
+  // every BATCH records and the worker publishes tail as it catches up
+  struct shard_t
+  {
+    cache_sim_t* cache;
+    record_t queue[QUEUE_SIZE];
+    size_t pending; // producer's head, not yet published
+    std::atomic<size_t> head;
+    char pad[64]; // keep head and tail on separate lines
+    std::atomic<size_t> tail;
+    std::thread worker;
+  };
+
+  void run(shard_t* s);
+  void publish(shard_t* s);
+
+  size_t shard_shift;
+  std::vector<shard_t*> shards;
+  std::atomic<bool> stop;
+};
+
 class cache_memtracer_t : public memtracer_t
 {
  public:
@@ -88,6 +171,11 @@ class cache_memtracer_t : public memtracer_t
   {
     cache->set_miss_handler(mh);
   }
+  cache_sim_t* get_cache() { return cache; }
+  void set_prefetcher(const char* config)
+  {
+    cache->set_prefetcher(config);
+  }
 
  protected:
   cache_sim_t* cache;
@@ -103,7 +191,11 @@ class icache_sim_t : public cache_memtracer_t
   }
   void trace(uint64_t addr, size_t bytes, access_type type)
   {
-    if (type == FETCH) cache->access(addr, bytes, false);
+    trace_pc(addr, bytes, type, 0);
+  }
+  void trace_pc(uint64_t addr, size_t bytes, access_type type, uint64_t pc)
+  {
+    if (type == FETCH) cache->access(addr, bytes, false, pc);
   }
 };
 
@@ -117,7 +209,11 @@ class dcache_sim_t : public cache_memtracer_t
   }
   void trace(uint64_t addr, size_t bytes, access_type type)
   {
-    if (type == LOAD || type == STORE) cache->access(addr, bytes, type == STORE);
+    trace_pc(addr, bytes, type, 0);
+  }
+  void trace_pc(uint64_t addr, size_t bytes, access_type type, uint64_t pc)
+  {
+    if (type == LOAD || type == STORE) cache->access(addr, bytes, type == STORE, pc);
   }
 };
 
@@ -0,0 +1,183 @@
+// See LICENSE for license details.
+
+#include "cachesweep.h"
+#include "common.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+static void help()
+{
+  std::cerr << "Cache sweep configurations must be of the form" << std::endl;
+  std::cerr << "  minsize:maxsize:ways:blocksize" << std::endl;
+  std::cerr << "where all four are powers of two, minsize is at most maxsize," << std::endl;
+  std::cerr << "and blocksize is at least 8." << std::endl;
+  exit(1);
+}
+
+static bool is_pow2(size_t x)
+{
+  return x != 0 && (x & (x-1)) == 0;
+}
+
+static size_t ilog2(size_t x)
+{
+  size_t n = 0;
+  while (x > 1)
+    x >>= 1, n++;
+  return n;
+}
+
+cache_sweep_t::cache_sweep_t(const char* config, const char* _name, bool _fetch)
+  : name(_name), fetch(_fetch), accesses(0), fenwick(1 << 20), now(0)
+{
+  std::vector<size_t> fields;
+  for (const char* p = config; ; p++) {
+    fields.push_back(atol(p));
+    if (!(p = strchr(p, ':')))
+      break;
+  }
+  if (fields.size() != 4)
+    help();
+
+  min_size = fields[0];
+  max_size = fields[1];
+  max_ways = fields[2];
+  linesz = fields[3];
+  if (!is_pow2(min_size) || !is_pow2(max_size) || !is_pow2(max_ways) ||
+      !is_pow2(linesz) || linesz < 8 || min_size > max_size ||
+      max_size < linesz)
+    help();
+  idx_shift = ilog2(linesz);
+  min_size = std::max(min_size, linesz);
+
+  // every set count some (size, ways) point of the grid needs, each with
+  // stacks just deep enough for the most ways it is asked about
+  size_t max_lines = max_size / linesz;
+  size_t min_sets = std::max<size_t>(1, min_size / linesz / max_ways);
+  for (size_t sets = min_sets; sets <= max_lines; sets *= 2) {
+    stacks_t s;
+    s.sets = sets;
+    s.depth = std::min(max_ways, max_lines / sets);
+    s.lines.resize(sets * s.depth);
+    s.hist.resize(s.depth + 1);
+    stacks.push_back(s);
+  }
+
+  fa_hist.resize(ilog2(max_lines) + 2);
+}
+
+cache_sweep_t::~cache_sweep_t()
+{
+  print_stats();
+}
+
+void cache_sweep_t::access(uint64_t line)
+{
+  accesses++;
+
+  // tags are stored off by one so that zero means an empty way
+  uint64_t tag = line + 1;
+  for (auto& s : stacks) {
+    uint64_t* base = &s.lines[(line & (s.sets-1)) * s.depth];
+    size_t i = 0;
+    while (i < s.depth && base[i] != tag)
+      i++;
+    s.hist[i]++;
+    memmove(base + 1, base, std::min(i, s.depth-1) * sizeof(uint64_t));
+    base[0] = tag;
+  }
+
+  size_t d = fa_distance(line);
+  fa_hist[std::min(d == SIZE_MAX ? fa_hist.size()-1 : d ? ilog2(d)+1 : 0,
+                   fa_hist.size()-1)]++;
+}
+
+// the number of distinct lines touched since line was last, or SIZE_MAX
+size_t cache_sweep_t::fa_distance(uint64_t line)
+{
+  if (now + 1 == fenwick.size())
+    fa_compact();
+  now++;
+
+  size_t distance = SIZE_MAX;
+  auto it = last_access.find(line);
+  if (it != last_access.end()) {
+    uint64_t then = it->second;
+    distance = 0;
+    for (uint64_t t = now - 1; t > 0; t -= t & -t)
+      distance += fenwick[t];
+    for (uint64_t t = then; t > 0; t -= t & -t)
+      distance -= fenwick[t];
+    for (uint64_t t = then; t < fenwick.size(); t += t & -t)
+      fenwick[t]--;
+    it->second = now;
+  } else {
+    last_access[line] = now;
+  }
+
+  for (uint64_t t = now; t < fenwick.size(); t += t & -t)
+    fenwick[t]++;
+  return distance;
+}
+
+// renumber the live access times 1..n once the tree fills up
+void cache_sweep_t::fa_compact()
+{
+  std::vector<std::pair<uint64_t, uint64_t>> order;
+  for (auto& la : last_access)
+    order.push_back(std::make_pair(la.second, la.first));
+  std::sort(order.begin(), order.end());
+
+  // lines farther back than the largest cache miss anyway
+  size_t keep = std::min(order.size(), max_size / linesz);
+  last_access.clear();
+  std::fill(fenwick.begin(), fenwick.end(), 0);
+  if (fenwick.size() < 2 * keep + 2)
+    fenwick.resize(2 * keep + 2);
+
+  now = 0;
+  for (size_t i = order.size() - keep; i < order.size(); i++) {
+    last_access[order[i].second] = ++now;
+    for (uint64_t t = now; t < fenwick.size(); t += t & -t)
+      fenwick[t]++;
+  }
+}
+
+void cache_sweep_t::print_stats()
+{
+  if (accesses == 0)
+    return;
+
+  std::cout << std::setprecision(3) << std::fixed;
+  std::cout << name << " Accesses: " << accesses << std::endl;
+  std::cout << name << " Miss Rate (%) by size and ways" << std::endl;
+  std::cout << name << " " << std::setw(10) << "size";
+  for (size_t w = 1; w <= max_ways; w *= 2)
+    std::cout << std::setw(9) << w;
+  std::cout << std::setw(9) << "full" << std::endl;
+
+  for (size_t size = min_size; size <= max_size; size *= 2) {
+    size_t lines = size / linesz;
+    std::cout << name << " " << std::setw(10) << size;
+    for (size_t w = 1; w <= max_ways; w *= 2) {
+      if (w > lines) {
+        std::cout << std::setw(9) << "-";
+        continue;
+      }
+      auto s = std::find_if(stacks.begin(), stacks.end(),
+                            [&](const stacks_t& s) { return s.sets == lines / w; });
+      uint64_t hits = 0;
+      for (size_t i = 0; i < w; i++)
+        hits += s->hist[i];
+      std::cout << std::setw(9) << 100.0 * (accesses - hits) / accesses;
+    }
+
+    uint64_t hits = 0;
+    for (size_t i = 0; i <= ilog2(lines); i++)
+      hits += fa_hist[i];
+    std::cout << std::setw(9) << 100.0 * (accesses - hits) / accesses << std::endl;
+  }
+}
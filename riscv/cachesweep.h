@@ -0,0 +1,68 @@
+// See LICENSE for license details.
+
+#ifndef _RISCV_CACHE_SWEEP_H
+#define _RISCV_CACHE_SWEEP_H
+
+#include "memtracer.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Miss ratios for a whole grid of LRU caches from a single run.  An access
+// hits in a W-way LRU cache iff fewer than W distinct lines of its set were
+// touched since the last access to its line (Mattson's stack distance), so
+// one LRU stack per set count answers every associativity at once, and a
+// Fenwick tree over access times gives the fully associative curve.
+class cache_sweep_t : public memtracer_t
+{
+ public:
+  // config is min:max:W:B -- sizes from min to max bytes, 1 to W ways,
+  // B-byte blocks, all powers of two
+  cache_sweep_t(const char* config, const char* name, bool fetch);
+  ~cache_sweep_t();
+
+  bool interested_in_range(uint64_t begin, uint64_t end, access_type type)
+  {
+    return (type == FETCH) == fetch;
+  }
+  void trace(uint64_t addr, size_t bytes, access_type type)
+  {
+    if ((type == FETCH) == fetch)
+      access(addr >> idx_shift);
+  }
+  void print_stats();
+
+ private:
+  // per-set LRU stacks for one set count, most recent first
+  struct stacks_t
+  {
+    size_t sets;
+    size_t depth;
+    std::vector<uint64_t> lines;
+    std::vector<uint64_t> hist; // hits by stack position; hist[depth] misses
+  };
+
+  void access(uint64_t line);
+  size_t fa_distance(uint64_t line);
+  void fa_compact();
+
+  std::string name;
+  bool fetch;
+  size_t min_size;
+  size_t max_size;
+  size_t max_ways;
+  size_t linesz;
+  size_t idx_shift;
+  uint64_t accesses;
+  std::vector<stacks_t> stacks;
+
+  // fully associative: the time of each line's last access, and a Fenwick
+  // tree marking the times that are still some line's last access
+  std::unordered_map<uint64_t, uint64_t> last_access;
+  std::vector<uint32_t> fenwick;
+  uint64_t now;
+  std::vector<uint64_t> fa_hist; // by ilog2(distance)+1; the last entry is cold
+};
+
+#endif
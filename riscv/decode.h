@@ -21,8 +21,14 @@ typedef uint64_t freg_t;
 
 const int NXPR = 32;
 const int NFPR = 32;
+const int NVPR = 32;
 const int NCSR = 4096;
 
+// vector register width and the widest element, in bits
+const int VLEN = 128;
+const int VLENB = VLEN / 8;
+const int ELEN = 64;
+
 #define X_RA 1
 #define X_SP 2
 
@@ -77,6 +83,11 @@ public:
   uint64_t rm() { return x(12, 3); }
   uint64_t csr() { return x(20, 12); }
 
+  uint64_t v_vm() { return x(25, 1); }
+  uint64_t v_zimm10() { return x(20, 10); }
+  uint64_t v_zimm11() { return x(20, 11); }
+  int64_t v_simm5() { return xs(15, 5); }
+
   int64_t rvc_imm() { return x(2, 5) + (xs(12, 1) << 5); }
   int64_t rvc_zimm() { return x(2, 5) + (x(12, 1) << 5); }
   int64_t rvc_addi4spn_imm() { return (x(6, 1) << 2) + (x(5, 1) << 3) + (x(11, 2) << 4) + (x(7, 4) << 6); }
@@ -128,21 +139,21 @@ private:
 #define RS2 READ_REG(insn.rs2())
 #define WRITE_RD(value) WRITE_REG(insn.rd(), value)
 
-// #ifndef RISCV_ENABLE_COMMITLOG
-// # define WRITE_REG(reg, value) STATE.XPR.write(reg, value)
-// # define WRITE_FREG(reg, value) DO_WRITE_FREG(reg, value)
-// #else
+// Instruction handlers are instantiated with and without commit logging (see
+// insn_template.cc); code outside of them always records its writes.
+static const bool commit_log = true;
 # define WRITE_REG(reg, value) ({ \
     reg_t wdata = (value); /* value may have side effects */ \
-    STATE.log_reg_write = (commit_log_reg_t){(reg) << 1, wdata}; \
+    if (commit_log) \
+      STATE.log_reg_write = (commit_log_reg_t){(reg) << 1, wdata}; \
     STATE.XPR.write(reg, wdata); \
   })
 # define WRITE_FREG(reg, value) ({ \
     freg_t wdata = (value); /* value may have side effects */ \
-    STATE.log_reg_write = (commit_log_reg_t){((reg) << 1) | 1, wdata}; \
+    if (commit_log) \
+      STATE.log_reg_write = (commit_log_reg_t){((reg) << 1) | 1, wdata}; \
     DO_WRITE_FREG(reg, wdata); \
   })
-// #endif
 
 // RVC macros
 #define WRITE_RVC_RS1S(value) WRITE_REG(insn.rvc_rs1s(), value)
@@ -170,13 +181,34 @@ private:
 #define JUMP_TARGET (pc + insn.uj_imm())
 #define RM ({ int rm = insn.rm(); \
               if(rm == 7) rm = STATE.frm; \
-              if(rm > 4) throw trap_illegal_instruction(); \
+              if(rm > 4) post_trap(CAUSE_ILLEGAL_INSTRUCTION); \
               rm; })
 
 #define get_field(reg, mask) (((reg) & (decltype(reg))(mask)) / ((mask) & ~((mask) << 1)))
 #define set_field(reg, mask, val) (((reg) & ~(decltype(reg))(mask)) | (((decltype(reg))(val) * ((mask) & ~((mask) << 1))) & (decltype(reg))(mask)))
 
-#define require(x) if (unlikely(!(x))) throw trap_illegal_instruction()
+// Instruction handlers report common synchronous traps by returning PC_TRAP
+// with the cause in STATE.pending_trap, which is much cheaper than unwinding.
+#define post_trap(cause) \
+  do { STATE.pending_trap = (cause); return PC_TRAP; } while(0)
+
+// and faulting loads and stores (see mmu_t::try_load_*) the same way
+#define MMU_LOAD(type, addr) ({ \
+    type##_t lval; \
+    if (unlikely(!MMU.try_load_##type(addr, &lval))) { \
+      MMU.post_fault(&STATE); \
+      return PC_TRAP; \
+    } \
+    lval; })
+#define MMU_STORE(type, addr, val) \
+  do { \
+    if (unlikely(!MMU.try_store_##type(addr, val))) { \
+      MMU.post_fault(&STATE); \
+      return PC_TRAP; \
+    } \
+  } while(0)
+
+#define require(x) do { if (unlikely(!(x))) post_trap(CAUSE_ILLEGAL_INSTRUCTION); } while(0)
 #define require_privilege(p) require(STATE.prv >= (p))
 #define require_rv64 require(xlen == 64)
 #define require_rv32 require(xlen == 32)
@@ -184,11 +216,12 @@ private:
 #define require_fp require((STATE.mstatus & MSTATUS_FS) != 0)
 #define require_accelerator require((STATE.mstatus & MSTATUS_XS) != 0)
 
-#define set_fp_exceptions ({ if (softfloat_exceptionFlags) { \
+#define set_fp_exceptions ({ uint_fast8_t flags = softfloat_exceptionFlags; \
+                             if (flags) { \
                                dirty_fp_state; \
-                               STATE.fflags |= softfloat_exceptionFlags; \
-                             } \
-                             softfloat_exceptionFlags = 0; })
+                               STATE.fflags |= flags; \
+                               softfloat_exceptionFlags = 0; \
+                             } })
 
 #define sext32(x) ((sreg_t)(int32_t)(x))
 #define zext32(x) ((reg_t)(uint32_t)(x))
@@ -210,6 +243,7 @@ private:
 /* Sentinel PC values to serialize simulator pipeline */
 #define PC_SERIALIZE_BEFORE 3
 #define PC_SERIALIZE_AFTER 5
+#define PC_TRAP 7 /* take the trap posted in STATE.pending_trap */
 #define invalid_pc(pc) ((pc) & 1)
 
 /* Convenience wrappers to simplify softfloat code sequences */
@@ -222,7 +256,7 @@ private:
   unsigned csr_priv = get_field((which), 0x300); \
   unsigned csr_read_only = get_field((which), 0xC00) == 3; \
   if (((write) && csr_read_only) || STATE.prv < csr_priv) \
-    throw trap_illegal_instruction(); \
+    post_trap(CAUSE_ILLEGAL_INSTRUCTION); \
   (which); })
 
 #define DEBUG_START             0x100
@@ -0,0 +1,73 @@
+// See LICENSE for license details.
+
+#include "elf_program.h"
+#include <elf.h>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+template<class Ehdr, class Phdr, class Shdr, class Sym>
+void elf_program_t::parse()
+{
+  auto eh = (const Ehdr*)&image[0];
+  if (eh->e_phoff + (size_t)eh->e_phnum * sizeof(Phdr) > image.size() ||
+      eh->e_shoff + (size_t)eh->e_shnum * sizeof(Shdr) > image.size()) {
+    error = "truncated ELF file";
+    return;
+  }
+
+  auto ph = (const Phdr*)&image[eh->e_phoff];
+  for (unsigned i = 0; i < eh->e_phnum; i++) {
+    if (ph[i].p_type != PT_LOAD || ph[i].p_filesz == 0)
+      continue;
+    if (ph[i].p_offset + ph[i].p_filesz > image.size()) {
+      error = "truncated ELF file";
+      return;
+    }
+    segments.push_back({(uint64_t)ph[i].p_paddr, (size_t)ph[i].p_offset,
+                        (size_t)ph[i].p_filesz});
+  }
+
+  auto sh = (const Shdr*)&image[eh->e_shoff];
+  for (unsigned i = 0; i < eh->e_shnum; i++) {
+    if (sh[i].sh_type != SHT_SYMTAB || sh[i].sh_link >= eh->e_shnum)
+      continue;
+    const Shdr& strtab = sh[sh[i].sh_link];
+    if (sh[i].sh_offset + sh[i].sh_size > image.size() ||
+        strtab.sh_offset + strtab.sh_size > image.size())
+      continue;
+
+    auto sym = (const Sym*)&image[sh[i].sh_offset];
+    for (size_t j = 0; j < sh[i].sh_size / sizeof(Sym); j++) {
+      if (sym[j].st_name >= strtab.sh_size)
+        continue;
+      const char* name = &image[strtab.sh_offset + sym[j].st_name];
+      size_t len = strnlen(name, strtab.sh_size - sym[j].st_name);
+      if (std::string(name, len) == "tohost")
+        tohost = sym[j].st_value;
+      else if (std::string(name, len) == "fromhost")
+        fromhost = sym[j].st_value;
+    }
+  }
+  if (!tohost)
+    error = "no tohost symbol";
+}
+
+void elf_program_t::load(const char* path)
+{
+  std::ifstream in(path, std::ios::binary);
+  image.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  segments.clear();
+  tohost = fromhost = 0;
+  error.clear();
+  if (!in.is_open() || (!in.good() && !in.eof()))
+    error = "could not read file";
+  else if (image.size() < sizeof(Elf64_Ehdr) || memcmp(&image[0], ELFMAG, SELFMAG) != 0)
+    error = "not an ELF file";
+  else if (image[EI_CLASS] == ELFCLASS32)
+    parse<Elf32_Ehdr, Elf32_Phdr, Elf32_Shdr, Elf32_Sym>();
+  else if (image[EI_CLASS] == ELFCLASS64)
+    parse<Elf64_Ehdr, Elf64_Phdr, Elf64_Shdr, Elf64_Sym>();
+  else
+    error = "unknown ELF class";
+}
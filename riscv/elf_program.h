@@ -0,0 +1,36 @@
+// See LICENSE for license details.
+
+#ifndef _RISCV_ELF_PROGRAM_H
+#define _RISCV_ELF_PROGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// An ELF program read into host memory: where its loadable segments go and
+// its tohost and fromhost symbols.  Reading it writes nothing to a target,
+// so it can find the symbols of a program fesvr has already loaded.
+struct elf_program_t
+{
+  struct segment_t
+  {
+    uint64_t addr;
+    size_t offset; // in image
+    size_t size;
+  };
+
+  std::vector<char> image;
+  std::vector<segment_t> segments;
+  uint64_t tohost;
+  uint64_t fromhost;
+  std::string error; // empty if the program was read and has tohost
+
+  void load(const char* path);
+
+ private:
+  template<class Ehdr, class Phdr, class Shdr, class Sym>
+  void parse();
+};
+
+#endif
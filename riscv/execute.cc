@@ -3,22 +3,43 @@
 #include "processor.h"
 #include "mmu.h"
 #include "sim.h"
+#include "trace_writer.h"
 #include <cassert>
 
 
-static void commit_log_stash_privilege(state_t* state)
+static void commit_log_stash_privilege(processor_t* p, reg_t pc)
 {
+  state_t* state = p->get_state();
 // #ifdef RISCV_ENABLE_COMMITLOG
   state->last_inst_priv = state->prv;
 // #endif
+  state->log_reg_write.addr = 0;
+  if (unlikely(p->get_trace_writer() != NULL))
+    p->get_trace_writer()->begin(p->get_mmu()->fetch_addr(pc));
+}
+
+static void commit_log_trace_insn(processor_t* p, reg_t pc, insn_t insn, reg_t npc)
+{
+  // instructions that serialize after themselves have retired and set the pc
+  if (npc == PC_SERIALIZE_AFTER)
+    npc = p->get_state()->pc;
+  else if (invalid_pc(npc))
+    return;
+  if (p->get_trace_writer())
+    p->get_trace_writer()->retire(pc, insn, npc, p->get_state()->log_reg_write);
+  if (p->get_commit_handler())
+    p->get_commit_handler()(p, pc, insn, p->get_state()->log_reg_write);
 }
 
-static void commit_log_print_insn(state_t* state, reg_t pc, insn_t insn)
+static void commit_log_print_insn(processor_t* p, reg_t pc, insn_t insn)
 {
+  state_t* state = p->get_state();
   uint64_t mask = (insn.length() == 8 ? uint64_t(0) : (uint64_t(1) << (insn.length() * 8))) - 1;
 #ifdef RISCV_ENABLE_COMMITLOG
   int32_t priv = state->last_inst_priv;
-  if (state->log_reg_write.addr) {
+  if (!p->get_print_commits())
+    ;
+  else if (state->log_reg_write.addr) {
     fprintf(stderr, "%1d 0x%016" PRIx64 " (0x%08" PRIx64 ") %c%2" PRIu64 " 0x%016" PRIx64 "\n",
             priv,
             pc,
@@ -46,12 +67,17 @@ inline void processor_t::update_histogram(reg_t pc)
 // This is expected to be inlined by the compiler so each use of execute_insn
 // includes a duplicated body of the function to get separate fetch.func
 // function calls.
+template<bool logged>
 static reg_t execute_insn(processor_t* p, reg_t pc, insn_fetch_t fetch)
 {
-  commit_log_stash_privilege(p->get_state());
+  if (logged)
+    commit_log_stash_privilege(p, pc);
   reg_t npc = fetch.func(p, fetch.insn, pc);
+  if (logged && unlikely(p->get_trace_writer() != NULL || p->get_commit_handler()))
+    commit_log_trace_insn(p, pc, fetch.insn, npc);
   if (!invalid_pc(npc)) {
-    commit_log_print_insn(p->get_state(), pc, fetch.insn);
+    if (logged)
+      commit_log_print_insn(p, pc, fetch.insn);
     p->update_histogram(pc);
   }
   return npc;
@@ -78,171 +104,214 @@ void processor_t::step(size_t n)
     n = std::min(n, (size_t) 11);
   }
 
+  // Each mode has its own instantiation of the loop below, so the plain fast
+  // path carries no commit-log or lockstep bookkeeping.  The mode can only
+  // change when a batch ends (serialization, traps, debug entry), so it is
+  // chosen once per batch.
   while (n > 0) {
-    size_t instret = 0;
-    reg_t pc = state.pc;
-    mmu_t* _mmu = mmu;
-
-    #define advance_pc() \
-     if (unlikely(invalid_pc(pc))) { \
-       switch (pc) { \
-         case PC_SERIALIZE_BEFORE: state.serialized = true; break; \
-         case PC_SERIALIZE_AFTER: instret++; break; \
-         default: abort(); \
-       } \
-       pc = state.pc; \
-       break; \
-     } else { \
-       state.pc = pc; \
-       instret++; \
-     }
-
-    try
-    {
-      if (unlikely(!lockstep)) {
-        take_interrupt();
-      } else if (unlikely(state.interrupt)) {
-        state.interrupt = false;
-        raise_interrupt(state.interrupt_cause);
-      }
+    if (unlikely(lockstep))
+      execute_batch<STEP_LOCKSTEP, true>(n);
+    else if (unlikely(slow_path()))
+      log_commits ? execute_batch<STEP_SLOW, true>(n)
+                  : execute_batch<STEP_SLOW, false>(n);
+    else
+      log_commits ? execute_batch<STEP_FAST, true>(n)
+                  : execute_batch<STEP_FAST, false>(n);
+  }
 
-      if (likely(lockstep))
-      {
-        while (instret < n) {
-          auto fetch = mmu->access_icache(pc)->data;
-          pc = execute_insn(this, pc, fetch);
-          advance_pc();
-        }
-      }
-      else if (unlikely(slow_path()))
-      {
-        while (instret < n)
-        {
-          if (unlikely(state.single_step == state.STEP_STEPPING)) {
-            state.single_step = state.STEP_STEPPED;
-          }
-
-          insn_fetch_t fetch = mmu->load_insn(pc);
-          if (debug && !state.serialized)
-            disasm(fetch.insn);
-          pc = execute_insn(this, pc, fetch);
-          bool serialize_before = (pc == PC_SERIALIZE_BEFORE);
-
-          advance_pc();
-
-          if (unlikely(state.single_step == state.STEP_STEPPED) && !serialize_before) {
-            state.single_step = state.STEP_NONE;
-            enter_debug_mode(DCSR_CAUSE_STEP);
-            // enter_debug_mode changed state.pc, so we can't just continue.
-            break;
-          }
-        }
+  // other harts run next, and their stores must be able to break this
+  // hart's reservation
+  if (state.load_reservation != (reg_t)-1)
+    sim->mark_reserved_page(state.load_reservation);
+}
+
+// run instructions until n are retired or something serializes the pipeline
+template<processor_t::step_mode_t mode, bool logged>
+void processor_t::execute_batch(size_t& n)
+{
+  size_t instret = 0;
+  reg_t pc = state.pc;
+  mmu_t* _mmu = mmu;
+  bool trapped = false;
+
+  #define advance_pc() \
+   if (unlikely(invalid_pc(pc))) { \
+     switch (pc) { \
+       case PC_SERIALIZE_BEFORE: state.serialized = true; break; \
+       case PC_SERIALIZE_AFTER: instret++; break; \
+       case PC_TRAP: trapped = true; break; \
+       default: abort(); \
+     } \
+     pc = state.pc; \
+     break; \
+   } else { \
+     state.pc = pc; \
+     instret++; \
+   }
+
+  try
+  {
+    if (unlikely(!lockstep)) {
+      trapped = take_interrupt();
+    } else if (unlikely(state.interrupt)) {
+      state.interrupt = false;
+      state.pending_trap = ((reg_t)1 << (max_xlen-1)) | state.interrupt_cause;
+      trapped = true;
+    }
+
+    if (unlikely(trapped))
+      ; // deliver the interrupt below before executing anything
+    else if (mode == STEP_LOCKSTEP)
+    {
+      while (instret < n) {
+        auto fetch = mmu->access_icache(pc)->data;
+        pc = execute_insn<logged>(this, pc, fetch);
+        advance_pc();
       }
-      else while (instret < n)
+    }
+    else if (mode == STEP_SLOW)
+    {
+      while (instret < n)
       {
-        // This code uses a modified Duff's Device to improve the performance
-        // of executing instructions. While typical Duff's Devices are used
-        // for software pipelining, the switch statement below primarily
-        // benefits from separate call points for the fetch.func function call
-        // found in each execute_insn. This function call is an indirect jump
-        // that depends on the current instruction. By having an indirect jump
-        // dedicated for each icache entry, you improve the performance of the
-        // host's next address predictor. Each case in the switch statement
-        // allows for the program flow to contine to the next case if it
-        // corresponds to the next instruction in the program and instret is
-        // still less than n.
-        //
-        // According to Andrew Waterman's recollection, this optimization
-        // resulted in approximately a 2x performance increase.
-        //
-        // If there is support for compressed instructions, the mmu and the
-        // switch statement get more complicated. Each branch target is stored
-        // in the index corresponding to mmu->icache_index(), but consecutive
-        // non-branching instructions are stored in consecutive indices even if
-        // mmu->icache_index() specifies a different index (which is the case
-        // for 32-bit instructions in the presence of compressed instructions).
-
-        // This figures out where to jump to in the switch statement
-        size_t idx = _mmu->icache_index(pc);
-
-        // This gets the cached decoded instruction form the MMU. If the MMU
-        // does not have the current pc cached, it will refill the MMU and
-        // return the correct entry. ic_entry->data.func is the C++ function
-        // corresponding to the instruction.
-        auto ic_entry = _mmu->access_icache(pc);
-
-        // This macro is included in "icache.h" included within the switch
-        // statement below. The indirect jump corresponding to the instruction
-        // is located within the execute_insn() function call.
-        #define ICACHE_ACCESS(i) { \
-          insn_fetch_t fetch = ic_entry->data; \
-          ic_entry++; \
-          pc = execute_insn(this, pc, fetch); \
-          if (i == mmu_t::ICACHE_ENTRIES-1) break; \
-          if (unlikely(ic_entry->tag != pc)) goto miss; \
-          if (unlikely(instret+1 == n)) break; \
-          instret++; \
-          state.pc = pc; \
+        if (unlikely(state.single_step == state.STEP_STEPPING)) {
+          state.single_step = state.STEP_STEPPED;
         }
 
-        // This switch statement implements the modified Duff's device as
-        // explained above.
-        switch (idx) {
-          // "icache.h" is generated by the gen_icache script
-          #include "icache.h"
-        }
+        insn_fetch_t fetch = mmu->load_insn(pc);
+        if (debug && !state.serialized)
+          disasm(fetch.insn);
+        pc = execute_insn<logged>(this, pc, fetch);
+        bool serialize_before = (pc == PC_SERIALIZE_BEFORE);
 
         advance_pc();
-        continue;
 
-miss:
-        advance_pc();
-        // refill I$ if it looks like there wasn't a taken branch
-        if (pc > (ic_entry-1)->tag && pc <= (ic_entry-1)->tag + MAX_INSN_LENGTH)
-          _mmu->refill_icache(pc, ic_entry);
+        if (unlikely(state.single_step == state.STEP_STEPPED) && !serialize_before) {
+          state.single_step = state.STEP_NONE;
+          enter_debug_mode(DCSR_CAUSE_STEP);
+          // enter_debug_mode changed state.pc, so we can't just continue.
+          break;
+        }
       }
     }
-    catch(trap_t& t)
+    else while (instret < n)
     {
-      take_trap(t, pc);
-      n = instret;
+      // This code uses a modified Duff's Device to improve the performance
+      // of executing instructions. While typical Duff's Devices are used
+      // for software pipelining, the switch statement below primarily
+      // benefits from separate call points for the fetch.func function call
+      // found in each execute_insn. This function call is an indirect jump
+      // that depends on the current instruction. By having an indirect jump
+      // dedicated for each icache entry, you improve the performance of the
+      // host's next address predictor. Each case in the switch statement
+      // allows for the program flow to contine to the next case if it
+      // corresponds to the next instruction in the program and instret is
+      // still less than n.
+      //
+      // According to Andrew Waterman's recollection, this optimization
+      // resulted in approximately a 2x performance increase.
+      //
+      // If there is support for compressed instructions, the mmu and the
+      // switch statement get more complicated. Each branch target is stored
+      // in the index corresponding to mmu->icache_index(), but consecutive
+      // non-branching instructions are stored in consecutive indices even if
+      // mmu->icache_index() specifies a different index (which is the case
+      // for 32-bit instructions in the presence of compressed instructions).
+      //
+      // The icache is tagged by physical address. The MMU caches the
+      // translation of the page being executed (icache_vpage/icache_bias),
+      // so staying on that page costs one extra compare per instruction.
+
+      // This gets the cached decoded instruction form the MMU. If the MMU
+      // does not have the current pc cached, it will refill the MMU and
+      // return the correct entry. ic_entry->data.func is the C++ function
+      // corresponding to the instruction.
+      auto ic_entry = _mmu->access_icache(pc);
+
+      // This figures out where to jump to in the switch statement
+      size_t idx = ic_entry - &_mmu->icache[0];
+
+      // This macro is included in "icache.h" included within the switch
+      // statement below. The indirect jump corresponding to the instruction
+      // is located within the execute_insn() function call.
+      #define ICACHE_ACCESS(i) { \
+        insn_fetch_t fetch = ic_entry->data; \
+        ic_entry++; \
+        pc = execute_insn<logged>(this, pc, fetch); \
+        if (i == mmu_t::ICACHE_ENTRIES-1) break; \
+        if (unlikely(ic_entry->tag != pc + _mmu->icache_bias)) goto miss; \
+        if (unlikely((pc & PGMASK) != _mmu->icache_vpage)) goto miss; \
+        if (unlikely(instret+1 == n)) break; \
+        instret++; \
+        state.pc = pc; \
+      }
 
-      if (unlikely(state.single_step == state.STEP_STEPPED)) {
-        state.single_step = state.STEP_NONE;
-        enter_debug_mode(DCSR_CAUSE_STEP);
+      // This switch statement implements the modified Duff's device as
+      // explained above.
+      switch (idx % mmu_t::ICACHE_ENTRIES) {
+        // "icache.h" is generated by the gen_icache script
+        #include "icache.h"
       }
-      if (lockstep) step(1);
+
+      advance_pc();
+      continue;
+
+miss:
+      advance_pc();
+      // refill I$ if it looks like there wasn't a taken branch
+      reg_t paddr = pc + _mmu->icache_bias;
+      if ((pc & PGMASK) == _mmu->icache_vpage &&
+          paddr > (ic_entry-1)->tag && paddr <= (ic_entry-1)->tag + MAX_INSN_LENGTH)
+        _mmu->refill_icache(pc, ic_entry);
     }
-    catch (trigger_matched_t& t)
+
+    if (unlikely(trapped))
     {
-      if (mmu->matched_trigger) {
-        // This exception came from the MMU. That means the instruction hasn't
-        // fully executed yet. We start it again, but this time it won't throw
-        // an exception because matched_trigger is already set. (All memory
-        // instructions are idempotent so restarting is safe.)
+      n = instret;
+      finish_posted_trap(pc);
+    }
+  }
+  catch(trap_t& t)
+  {
+    n = instret;
+    finish_trap(t, pc);
+  }
+  catch (trigger_matched_t& t)
+  {
+    if (mmu->matched_trigger) {
+      // This exception came from the MMU. That means the instruction hasn't
+      // fully executed yet. We start it again, but this time it won't throw
+      // an exception because matched_trigger is already set. (All memory
+      // instructions are idempotent so restarting is safe.)
 
-        insn_fetch_t fetch = mmu->load_insn(pc);
-        pc = execute_insn(this, pc, fetch);
-        advance_pc();
+      insn_fetch_t fetch = mmu->load_insn(pc);
+      pc = execute_insn<logged>(this, pc, fetch);
+      do {
+        advance_pc(); // breaks out of its enclosing loop on a sentinel pc
+      } while (0);
 
-        delete mmu->matched_trigger;
-        mmu->matched_trigger = NULL;
-      }
-      switch (state.mcontrol[t.index].action) {
-        case ACTION_DEBUG_MODE:
-          enter_debug_mode(DCSR_CAUSE_HWBP);
-          break;
-        case ACTION_DEBUG_EXCEPTION: {
-          mem_trap_t trap(CAUSE_BREAKPOINT, t.address);
-          take_trap(trap, pc);
-          break;
-        }
-        default:
-          abort();
+      delete mmu->matched_trigger;
+      mmu->matched_trigger = NULL;
+    }
+    // a trap taken by the replayed instruction is delivered instead
+    if (unlikely(trapped)) {
+      n = instret;
+      finish_posted_trap(pc);
+    }
+    else switch (state.mcontrol[t.index].action) {
+      case ACTION_DEBUG_MODE:
+        enter_debug_mode(DCSR_CAUSE_HWBP);
+        break;
+      case ACTION_DEBUG_EXCEPTION: {
+        mem_trap_t trap(CAUSE_BREAKPOINT, t.address);
+        take_trap(trap, pc);
+        break;
       }
+      default:
+        abort();
     }
-
-    state.minstret += instret;
-    n -= instret;
   }
+
+  state.minstret += instret;
+  count_event(HPM_INSTRET, instret);
+  n -= instret;
 }
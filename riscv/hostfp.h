@@ -0,0 +1,136 @@
+// See LICENSE for license details.
+
+#ifndef _RISCV_HOSTFP_H
+#define _RISCV_HOSTFP_H
+
+// Drop-in replacements for the softfloat arithmetic functions that do the
+// common case on the host FPU, whose SSE or AArch64 arithmetic is IEEE 754
+// like RISC-V's.  Reading and clearing the host's exception flags costs more
+// than softfloat itself, so the host is used only when it can't raise a flag
+// RISC-V would record: rounding to nearest-even, as the host does, with the
+// guest's inexact flag already set (it is sticky), normal or zero inputs and
+// a normal result, or a zero one that must be exact.  Anything else -- NaNs,
+// infinities, subnormals, overflow, underflow, division by zero, the other
+// rounding modes -- is done by softfloat, which sets the flags.
+
+#include "softfloat.h"
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__aarch64__)
+#define HOSTFP 1
+
+static inline float hostfp_h(float32_t x) { float h; memcpy(&h, &x.v, 4); return h; }
+static inline double hostfp_h(float64_t x) { double h; memcpy(&h, &x.v, 8); return h; }
+static inline float32_t hostfp_s(float h) { float32_t x; memcpy(&x.v, &h, 4); return x; }
+static inline float64_t hostfp_s(double h) { float64_t x; memcpy(&x.v, &h, 8); return x; }
+
+static inline bool hostfp_input(float32_t x)
+{
+  uint32_t exp = x.v & 0x7f800000;
+  return exp != 0x7f800000 && (exp != 0 || (x.v << 1) == 0);
+}
+static inline bool hostfp_input(float64_t x)
+{
+  uint64_t exp = x.v & 0x7ff0000000000000;
+  return exp != 0x7ff0000000000000 && (exp != 0 || (x.v << 1) == 0);
+}
+
+// false for NaN, infinity and anything that may be tiny after rounding
+template<class H>
+static inline bool hostfp_normal(H r)
+{
+  H mag = r < 0 ? -r : r;
+  return mag > std::numeric_limits<H>::min() && mag <= std::numeric_limits<H>::max();
+}
+
+static inline bool hostfp_usable(uint64_t fflags)
+{
+  return (fflags & softfloat_flag_inexact) &&
+         softfloat_roundingMode == softfloat_round_near_even;
+}
+
+#ifdef __x86_64__
+// fused multiply-add needs FMA3, which not every x86-64 has
+__attribute__((target("fma"))) static float hostfp_fma(float a, float b, float c)
+{
+  return __builtin_fmaf(a, b, c);
+}
+__attribute__((target("fma"))) static double hostfp_fma(double a, double b, double c)
+{
+  return __builtin_fma(a, b, c);
+}
+static inline bool hostfp_have_fma()
+{
+  static const bool have = __builtin_cpu_supports("fma");
+  return have;
+}
+#else
+static inline float hostfp_fma(float a, float b, float c) { return __builtin_fmaf(a, b, c); }
+static inline double hostfp_fma(double a, double b, double c) { return __builtin_fma(a, b, c); }
+static inline bool hostfp_have_fma() { return true; }
+#endif
+
+static inline float hostfp_sqrt(float x) { return __builtin_sqrtf(x); }
+static inline double hostfp_sqrt(double x) { return __builtin_sqrt(x); }
+#endif
+
+// zero_ok says when a zero result is exact rather than an underflow
+#ifdef HOSTFP
+#define HOSTFP_BINARY(name, T, expr, zero_ok) \
+  static inline T hostfp_##name(uint64_t fflags, T a, T b) \
+  { \
+    if (hostfp_usable(fflags) && hostfp_input(a) && hostfp_input(b)) { \
+      auto x = hostfp_h(a), y = hostfp_h(b); \
+      auto r = expr; \
+      if (hostfp_normal(r) || (r == 0 && (zero_ok))) \
+        return hostfp_s(r); \
+    } \
+    return name(a, b); \
+  }
+#define HOSTFP_SQRT(name, T) \
+  static inline T hostfp_##name(uint64_t fflags, T a) \
+  { \
+    if (hostfp_usable(fflags) && hostfp_input(a)) { \
+      auto r = hostfp_sqrt(hostfp_h(a)); \
+      if (hostfp_normal(r) || r == 0) \
+        return hostfp_s(r); \
+    } \
+    return name(a); \
+  }
+#define HOSTFP_FMA(name, T) \
+  static inline T hostfp_##name(uint64_t fflags, T a, T b, T c) \
+  { \
+    if (hostfp_usable(fflags) && hostfp_have_fma() && \
+        hostfp_input(a) && hostfp_input(b) && hostfp_input(c)) { \
+      auto x = hostfp_h(a), y = hostfp_h(b), z = hostfp_h(c); \
+      auto r = hostfp_fma(x, y, z); \
+      if (hostfp_normal(r) || (r == 0 && (x == 0 || y == 0) && z == 0)) \
+        return hostfp_s(r); \
+    } \
+    return name(a, b, c); \
+  }
+#else
+#define HOSTFP_BINARY(name, T, expr, zero_ok) \
+  static inline T hostfp_##name(uint64_t fflags, T a, T b) { return name(a, b); }
+#define HOSTFP_SQRT(name, T) \
+  static inline T hostfp_##name(uint64_t fflags, T a) { return name(a); }
+#define HOSTFP_FMA(name, T) \
+  static inline T hostfp_##name(uint64_t fflags, T a, T b, T c) { return name(a, b, c); }
+#endif
+
+HOSTFP_BINARY(f32_add, float32_t, x + y, true)
+HOSTFP_BINARY(f32_sub, float32_t, x - y, true)
+HOSTFP_BINARY(f32_mul, float32_t, x * y, x == 0 || y == 0)
+HOSTFP_BINARY(f32_div, float32_t, x / y, x == 0)
+HOSTFP_SQRT(f32_sqrt, float32_t)
+HOSTFP_FMA(f32_mulAdd, float32_t)
+HOSTFP_BINARY(f64_add, float64_t, x + y, true)
+HOSTFP_BINARY(f64_sub, float64_t, x - y, true)
+HOSTFP_BINARY(f64_mul, float64_t, x * y, x == 0 || y == 0)
+HOSTFP_BINARY(f64_div, float64_t, x / y, x == 0)
+HOSTFP_SQRT(f64_sqrt, float64_t)
+HOSTFP_FMA(f64_mulAdd, float64_t)
+
+#endif
@@ -2,20 +2,33 @@
 
 #include "insn_template.h"
 
-reg_t rv32_NAME(processor_t* p, insn_t insn, reg_t pc)
+size_t insn_id_NAME = -1;
+
+template<int xlen, bool commit_log>
+static inline reg_t execute_NAME(processor_t* p, insn_t insn, reg_t pc)
 {
-  int xlen = 32;
   reg_t npc = sext_xlen(pc + insn_length(OPCODE));
   #include "insns/NAME.h"
-  trace_opcode(p, OPCODE, insn);
+  trace_opcode(p, OPCODE, insn, pc, npc, insn_id_NAME);
   return npc;
 }
 
+reg_t rv32_NAME(processor_t* p, insn_t insn, reg_t pc)
+{
+  return execute_NAME<32, false>(p, insn, pc);
+}
+
 reg_t rv64_NAME(processor_t* p, insn_t insn, reg_t pc)
 {
-  int xlen = 64;
-  reg_t npc = sext_xlen(pc + insn_length(OPCODE));
-  #include "insns/NAME.h"
-  trace_opcode(p, OPCODE, insn);
-  return npc;
+  return execute_NAME<64, false>(p, insn, pc);
+}
+
+reg_t rv32_logged_NAME(processor_t* p, insn_t insn, reg_t pc)
+{
+  return execute_NAME<32, true>(p, insn, pc);
+}
+
+reg_t rv64_logged_NAME(processor_t* p, insn_t insn, reg_t pc)
+{
+  return execute_NAME<64, true>(p, insn, pc);
 }
@@ -3,6 +3,8 @@
 #include "mmu.h"
 #include "mulhi.h"
 #include "softfloat.h"
+#include "hostfp.h"
+#include "vector.h"
 #include "internals.h"
 #include "tracer.h"
 #include <assert.h>
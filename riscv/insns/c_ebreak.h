@@ -1,2 +1,2 @@
 require_extension('C');
-throw trap_breakpoint();
+post_trap(CAUSE_BREAKPOINT);
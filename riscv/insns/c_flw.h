@@ -2,7 +2,7 @@ require_extension('C');
 if (xlen == 32) {
   require_extension('F');
   require_fp;
-  WRITE_RVC_FRS2S(MMU.load_int32(RVC_RS1S + insn.rvc_lw_imm()));
+  WRITE_RVC_FRS2S(MMU_LOAD(int32, RVC_RS1S + insn.rvc_lw_imm()));
 } else { // c.ld
-  WRITE_RVC_RS2S(MMU.load_int64(RVC_RS1S + insn.rvc_ld_imm()));
+  WRITE_RVC_RS2S(MMU_LOAD(int64, RVC_RS1S + insn.rvc_ld_imm()));
 }
@@ -1 +1 @@
-throw trap_breakpoint();
+post_trap(CAUSE_BREAKPOINT);
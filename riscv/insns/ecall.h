@@ -1,7 +1,7 @@
 switch (STATE.prv)
 {
-  case PRV_U: throw trap_user_ecall();
-  case PRV_S: throw trap_supervisor_ecall();
-  case PRV_H: throw trap_hypervisor_ecall();
-  case PRV_M: throw trap_machine_ecall();
+  case PRV_U: post_trap(CAUSE_USER_ECALL);
+  case PRV_S: post_trap(CAUSE_SUPERVISOR_ECALL);
+  case PRV_H: post_trap(CAUSE_HYPERVISOR_ECALL);
+  case PRV_M: post_trap(CAUSE_MACHINE_ECALL);
 }
@@ -1,5 +1,5 @@
 require_extension('D');
 require_fp;
 softfloat_roundingMode = RM;
-WRITE_FRD(f64_add(f64(FRS1), f64(FRS2)).v);
+WRITE_FRD(hostfp_f64_add(STATE.fflags, f64(FRS1), f64(FRS2)).v);
 set_fp_exceptions;
@@ -1 +0,0 @@
-MMU.flush_icache();
@@ -1,5 +1,5 @@
 require_extension('D');
 require_fp;
 softfloat_roundingMode = RM;
-WRITE_FRD(f64_mulAdd(f64(FRS1), f64(FRS2), f64(FRS3)).v);
+WRITE_FRD(hostfp_f64_mulAdd(STATE.fflags, f64(FRS1), f64(FRS2), f64(FRS3)).v);
 set_fp_exceptions;
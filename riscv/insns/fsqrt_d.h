@@ -1,5 +1,5 @@
 require_extension('D');
 require_fp;
 softfloat_roundingMode = RM;
-WRITE_FRD(f64_sqrt(f64(FRS1)).v);
+WRITE_FRD(hostfp_f64_sqrt(STATE.fflags, f64(FRS1)).v);
 set_fp_exceptions;
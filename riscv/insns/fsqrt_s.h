@@ -1,5 +1,5 @@
 require_extension('F');
 require_fp;
 softfloat_roundingMode = RM;
-WRITE_FRD(f32_sqrt(f32(FRS1)).v);
+WRITE_FRD(hostfp_f32_sqrt(STATE.fflags, f32(FRS1)).v);
 set_fp_exceptions;
@@ -1,5 +1,5 @@
 require_extension('F');
 require_fp;
 softfloat_roundingMode = RM;
-WRITE_FRD(f32_sub(f32(FRS1), f32(FRS2)).v);
+WRITE_FRD(hostfp_f32_sub(STATE.fflags, f32(FRS1), f32(FRS2)).v);
 set_fp_exceptions;
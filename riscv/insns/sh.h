@@ -1 +1 @@
-MMU.store_uint16(RS1 + insn.s_imm(), RS2);
+MMU_STORE(uint16, RS1 + insn.s_imm(), RS2);
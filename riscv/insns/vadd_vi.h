@@ -0,0 +1 @@
+VI_VI(u, vd = vs2 + vs1);
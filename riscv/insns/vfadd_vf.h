@@ -0,0 +1 @@
+VF_VF(vd = vfp_add(fflags, vs2, vs1));
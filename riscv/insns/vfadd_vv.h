@@ -0,0 +1 @@
+VF_VV(vd = vfp_add(fflags, vs2, vs1));
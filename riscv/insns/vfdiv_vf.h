@@ -0,0 +1 @@
+VF_VF(vd = vfp_div(fflags, vs2, vs1));
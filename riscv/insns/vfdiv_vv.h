@@ -0,0 +1 @@
+VF_VV(vd = vfp_div(fflags, vs2, vs1));
@@ -0,0 +1 @@
+VF_VF(vd = vfp_mulAdd(fflags, vs1, vs2, vd));
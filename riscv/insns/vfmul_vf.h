@@ -0,0 +1 @@
+VF_VF(vd = vfp_mul(fflags, vs2, vs1));
@@ -0,0 +1 @@
+VF_VV(vd = vfp_mul(fflags, vs2, vs1));
@@ -0,0 +1,6 @@
+VF_CHECK;
+if (STATE.vsew == 4)
+  WRITE_FRD(vreg<uint32_t>(STATE, insn.rs2())[0]);
+else
+  WRITE_FRD(vreg<uint64_t>(STATE, insn.rs2())[0]);
+STATE.vstart = 0;
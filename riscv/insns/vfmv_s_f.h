@@ -0,0 +1,8 @@
+VF_CHECK;
+if (STATE.vstart < STATE.vl) {
+  if (STATE.vsew == 4)
+    vreg<uint32_t>(STATE, insn.rd())[0] = FRS1;
+  else
+    vreg<uint64_t>(STATE, insn.rd())[0] = FRS1;
+}
+STATE.vstart = 0;
@@ -0,0 +1,3 @@
+VF_CHECK;
+VI_CHECK_VX;
+VI_LOOP(u, VI_SPLAT(u, FRS1), vd = vs1);
@@ -0,0 +1 @@
+VF_VF(vd = vfp_sub(fflags, vs2, vs1));
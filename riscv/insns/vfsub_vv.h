@@ -0,0 +1 @@
+VF_VV(vd = vfp_sub(fflags, vs2, vs1));
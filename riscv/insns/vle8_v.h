@@ -0,0 +1 @@
+VMEM_STRIDED(uint8_t, sizeof(uint8_t), false);
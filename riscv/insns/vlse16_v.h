@@ -0,0 +1 @@
+VMEM_STRIDED(uint16_t, RS2, false);
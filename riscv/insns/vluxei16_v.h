@@ -0,0 +1 @@
+VMEM_INDEXED(uint16_t, false);
@@ -0,0 +1 @@
+VMEM_INDEXED(uint32_t, false);
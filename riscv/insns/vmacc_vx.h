@@ -0,0 +1 @@
+VI_VX(u, vd = vs1 * vs2 + vd);
@@ -0,0 +1 @@
+VI_VV(s, vd = vs2 > vs1 ? vs2 : vs1);
@@ -0,0 +1 @@
+VI_VV(u, vd = vs2 > vs1 ? vs2 : vs1);
@@ -0,0 +1 @@
+VI_MERGE(insn.v_simm5());
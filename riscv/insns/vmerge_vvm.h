@@ -0,0 +1,2 @@
+require_vreg(insn.rs1(), STATE.vlmul);
+VI_MERGE(vs1_p[i]);
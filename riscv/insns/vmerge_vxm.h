@@ -0,0 +1 @@
+VI_MERGE(RS1);
@@ -0,0 +1 @@
+VI_VX(s, vd = vs2 < vs1 ? vs2 : vs1);
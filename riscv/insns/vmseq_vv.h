@@ -0,0 +1 @@
+VI_CMP_VV(u, vs2 == vs1);
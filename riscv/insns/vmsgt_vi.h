@@ -0,0 +1 @@
+VI_CMP_VI(s, vs2 > vs1);
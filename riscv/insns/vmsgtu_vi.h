@@ -0,0 +1 @@
+VI_CMP_VI(u, vs2 > vs1);
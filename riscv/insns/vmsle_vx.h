@@ -0,0 +1 @@
+VI_CMP_VX(s, vs2 <= vs1);
@@ -0,0 +1 @@
+VI_CMP_VV(s, vs2 < vs1);
@@ -0,0 +1 @@
+VI_CMP_VX(u, vs2 < vs1);
@@ -0,0 +1,5 @@
+require_vector;
+if (STATE.vstart < STATE.vl) {
+  VI_SEW_SWITCH(vreg<u_t>(STATE, insn.rd())[0] = RS1;)
+}
+STATE.vstart = 0;
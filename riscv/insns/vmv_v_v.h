@@ -0,0 +1 @@
+VI_VV(u, vd = vs1);
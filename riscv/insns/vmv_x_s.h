@@ -0,0 +1,3 @@
+require_vector;
+VI_SEW_SWITCH(WRITE_RD(sext_xlen((s_t)vreg<u_t>(STATE, insn.rs2())[0]));)
+STATE.vstart = 0;
@@ -0,0 +1 @@
+VI_REDSUM;
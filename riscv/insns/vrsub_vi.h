@@ -0,0 +1 @@
+VI_VI(u, vd = vs1 - vs2);
@@ -0,0 +1 @@
+VMEM_STRIDED(uint16_t, sizeof(uint16_t), true);
@@ -0,0 +1 @@
+VMEM_STRIDED(uint32_t, sizeof(uint32_t), true);
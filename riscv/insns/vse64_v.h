@@ -0,0 +1 @@
+VMEM_STRIDED(uint64_t, sizeof(uint64_t), true);
@@ -0,0 +1,2 @@
+require(p->supports_vector());
+WRITE_RD(vector_set_vl(STATE, xlen, insn.rs1(), insn.v_zimm10(), false));
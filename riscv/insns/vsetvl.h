@@ -0,0 +1,3 @@
+require(p->supports_vector());
+WRITE_RD(vector_set_vl(STATE, xlen, insn.rs1() ? zext_xlen(RS1) : reg_t(-1),
+                       zext_xlen(RS2), insn.rs1() == 0 && insn.rd() == 0));
@@ -0,0 +1 @@
+VI_VV(u, vd = vs2 << VI_SHAMT(u));
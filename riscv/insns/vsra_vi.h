@@ -0,0 +1 @@
+VI_VIU(s, vd = vs2 >> VI_SHAMT(s));
@@ -0,0 +1 @@
+VI_VV(s, vd = vs2 >> VI_SHAMT(s));
@@ -0,0 +1 @@
+VI_VX(s, vd = vs2 >> VI_SHAMT(s));
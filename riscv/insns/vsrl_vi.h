@@ -0,0 +1 @@
+VI_VIU(u, vd = vs2 >> VI_SHAMT(u));
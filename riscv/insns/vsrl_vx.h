@@ -0,0 +1 @@
+VI_VX(u, vd = vs2 >> VI_SHAMT(u));
@@ -0,0 +1 @@
+VMEM_STRIDED(uint32_t, RS2, true);
@@ -0,0 +1 @@
+VMEM_STRIDED(uint64_t, RS2, true);
@@ -0,0 +1 @@
+VMEM_STRIDED(uint8_t, RS2, true);
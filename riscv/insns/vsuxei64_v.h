@@ -0,0 +1 @@
+VMEM_INDEXED(uint64_t, true);
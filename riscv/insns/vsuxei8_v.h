@@ -0,0 +1 @@
+VMEM_INDEXED(uint8_t, true);
@@ -0,0 +1,284 @@
+// See LICENSE for license details.
+
+#include "libspike.h"
+#include "sim.h"
+#include "mmu.h"
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+namespace {
+
+class callback_device_t : public abstract_device_t
+{
+ public:
+  callback_device_t(uint64_t size, spike_mmio_load_fn load,
+                    spike_mmio_store_fn store, void* arg)
+    : size(size), load_fn(load), store_fn(store), arg(arg) {}
+
+  bool load(reg_t addr, size_t len, uint8_t* bytes)
+  {
+    return addr + len <= size && load_fn && load_fn(arg, addr, len, bytes) == 0;
+  }
+  bool store(reg_t addr, size_t len, const uint8_t* bytes)
+  {
+    return addr + len <= size && store_fn && store_fn(arg, addr, len, bytes) == 0;
+  }
+
+ private:
+  uint64_t size;
+  spike_mmio_load_fn load_fn;
+  spike_mmio_store_fn store_fn;
+  void* arg;
+};
+
+}
+
+struct spike
+{
+  sim_t sim;
+  std::vector<std::unique_ptr<callback_device_t>> devices;
+
+  spike(const char* isa, size_t harts, size_t mem_mb)
+    : sim(isa, harts, mem_mb, false, std::vector<std::string>()) {}
+};
+
+// nothing may unwind into the caller, which may not be C++, so every
+// entry point that can fail catches what spike throws and returns an error
+spike_t* spike_new(const char* isa, size_t harts, size_t mem_mb)
+{
+  isa_desc_t desc;
+  if (!isa || !processor_t::parse_isa_string(isa, &desc))
+    return NULL;
+  try {
+    return new spike(isa, harts, mem_mb);
+  } catch (std::exception& e) {
+    return NULL;
+  }
+}
+
+// NULL if the machine has no such hart
+static processor_t* core(spike_t* s, size_t hart)
+{
+  return hart < s->sim.num_cores() ? s->sim.get_core(hart) : NULL;
+}
+
+void spike_delete(spike_t* s)
+{
+  delete s;
+}
+
+size_t spike_num_harts(spike_t* s)
+{
+  return s->sim.num_cores();
+}
+
+uint64_t spike_mem_base(spike_t* s)
+{
+  return DRAM_BASE;
+}
+
+uint64_t spike_mem_size(spike_t* s)
+{
+  return s->sim.get_mem_size();
+}
+
+int spike_read_mem(spike_t* s, uint64_t addr, size_t len, void* bytes)
+{
+  mmu_t* mmu = s->sim.get_debug_mmu();
+  uint8_t* p = (uint8_t*)bytes;
+  try {
+    while (len) {
+      if ((addr & 7) == 0 && len >= 8) {
+        uint64_t x = mmu->load_uint64(addr);
+        memcpy(p, &x, 8);
+        addr += 8, p += 8, len -= 8;
+      } else {
+        *p = mmu->load_uint8(addr);
+        addr++, p++, len--;
+      }
+    }
+  } catch (trap_t& t) {
+    return -1;
+  }
+  return 0;
+}
+
+int spike_write_mem(spike_t* s, uint64_t addr, size_t len, const void* bytes)
+{
+  mmu_t* mmu = s->sim.get_debug_mmu();
+  const uint8_t* p = (const uint8_t*)bytes;
+  try {
+    while (len) {
+      if ((addr & 7) == 0 && len >= 8) {
+        uint64_t x;
+        memcpy(&x, p, 8);
+        mmu->store_uint64(addr, x);
+        addr += 8, p += 8, len -= 8;
+      } else {
+        mmu->store_uint8(addr, *p);
+        addr++, p++, len--;
+      }
+    }
+  } catch (trap_t& t) {
+    return -1;
+  }
+  return 0;
+}
+
+int spike_step(spike_t* s, size_t n)
+{
+  try {
+    s->sim.step(n);
+  } catch (std::exception& e) {
+    return -1;
+  }
+  return 0;
+}
+
+int spike_step_hart(spike_t* s, size_t hart, size_t n)
+{
+  processor_t* p = core(s, hart);
+  if (!p)
+    return -1;
+  try {
+    p->step(n);
+  } catch (std::exception& e) {
+    return -1;
+  }
+  return 0;
+}
+
+int spike_get_pc(spike_t* s, size_t hart, uint64_t* pc)
+{
+  processor_t* p = core(s, hart);
+  if (!p)
+    return -1;
+  *pc = p->get_state()->pc;
+  return 0;
+}
+
+int spike_set_pc(spike_t* s, size_t hart, uint64_t pc)
+{
+  processor_t* p = core(s, hart);
+  if (!p)
+    return -1;
+  p->get_state()->pc = pc;
+  return 0;
+}
+
+int spike_get_xreg(spike_t* s, size_t hart, unsigned reg, uint64_t* value)
+{
+  processor_t* p = core(s, hart);
+  if (!p || reg >= NXPR)
+    return -1;
+  *value = p->get_state()->XPR[reg];
+  return 0;
+}
+
+int spike_set_xreg(spike_t* s, size_t hart, unsigned reg, uint64_t value)
+{
+  processor_t* p = core(s, hart);
+  if (!p || reg >= NXPR)
+    return -1;
+  p->get_state()->XPR.write(reg, value);
+  return 0;
+}
+
+int spike_get_freg(spike_t* s, size_t hart, unsigned reg, uint64_t* value)
+{
+  processor_t* p = core(s, hart);
+  if (!p || reg >= NFPR)
+    return -1;
+  *value = p->get_state()->FPR[reg];
+  return 0;
+}
+
+int spike_set_freg(spike_t* s, size_t hart, unsigned reg, uint64_t value)
+{
+  processor_t* p = core(s, hart);
+  if (!p || reg >= NFPR)
+    return -1;
+  p->get_state()->FPR.write(reg, value);
+  return 0;
+}
+
+int spike_get_csr(spike_t* s, size_t hart, unsigned csr, uint64_t* value)
+{
+  processor_t* p = core(s, hart);
+  if (!p)
+    return -1;
+  try {
+    *value = p->get_csr(csr);
+  } catch (trap_t& t) {
+    return -1;
+  }
+  return 0;
+}
+
+int spike_set_csr(spike_t* s, size_t hart, unsigned csr, uint64_t value)
+{
+  processor_t* p = core(s, hart);
+  if (!p)
+    return -1;
+  try {
+    p->set_csr(csr, value);
+  } catch (trap_t& t) {
+    return -1;
+  }
+  return 0;
+}
+
+void spike_set_commit_callback(spike_t* s, spike_commit_fn fn, void* arg)
+{
+  processor_t::commit_handler_t h;
+  if (fn) {
+    h = [fn, arg](processor_t* p, reg_t pc, insn_t insn, const commit_log_reg_t& write) {
+      int reg = -1;
+      uint64_t value = 0;
+      if (write.addr) {
+        reg = (write.addr >> 1) | (write.addr & 1 ? 32 : 0);
+        value = write.data;
+      }
+      uint64_t bits = insn.bits();
+      if (insn.length() < 8)
+        bits &= (uint64_t(1) << (8 * insn.length())) - 1;
+      fn(arg, p->get_id(), pc, bits, reg, value);
+    };
+  }
+  for (size_t i = 0; i < s->sim.num_cores(); i++)
+    s->sim.get_core(i)->set_commit_handler(h);
+}
+
+int spike_add_mmio(spike_t* s, uint64_t base, uint64_t size,
+                   spike_mmio_load_fn load, spike_mmio_store_fn store,
+                   void* arg)
+{
+  try {
+    s->devices.emplace_back(new callback_device_t(size, load, store, arg));
+    s->sim.add_device(base, s->devices.back().get());
+  } catch (std::exception& e) {
+    return -1;
+  }
+  return 0;
+}
+
+int spike_snapshot(spike_t* s)
+{
+  try {
+    s->sim.snapshot();
+  } catch (std::exception& e) {
+    return -1;
+  }
+  return 0;
+}
+
+int spike_restore(spike_t* s)
+{
+  try {
+    s->sim.restore();
+  } catch (std::exception& e) {
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,90 @@
+// See LICENSE for license details.
+
+#ifndef _RISCV_LIBSPIKE_H
+#define _RISCV_LIBSPIKE_H
+
+// A C interface for running a machine inside another program, such as an
+// RTL testbench or a Python script (through ctypes), with no htif host
+// loop: the caller loads memory, steps the harts and looks at the results.
+//
+// spike_t* s = spike_new("RV64IMAFDC", 1, 256);
+// spike_write_mem(s, spike_mem_base(s), size, image);
+// spike_step(s, 1000);
+// uint64_t a0;
+// spike_get_xreg(s, 0, 10, &a0);
+// spike_delete(s);
+//
+// Harts start at the boot ROM, which jumps to the start of memory.
+// Functions returning int return 0 on success and -1 on an access fault, a
+// hart or register that doesn't exist, or an error inside spike; functions
+// that read a value only store it on success.  A spike_t may only be used
+// by one thread at a time.
+//
+// Machines on different threads are independent: softfloat keeps its
+// rounding mode and flags per thread.  That state uses the dynamic TLS
+// model, so libriscv.so and libsoftfloat.so can be loaded with dlopen()
+// (as ctypes does).  FP instructions therefore run somewhat slower than
+// they would with softfloat built into the program itself.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct spike spike_t;
+
+// mem_mb megabytes of memory at spike_mem_base; NULL if spike can't model
+// the ISA string or build the machine
+spike_t* spike_new(const char* isa, size_t harts, size_t mem_mb);
+void spike_delete(spike_t* s);
+size_t spike_num_harts(spike_t* s);
+uint64_t spike_mem_base(spike_t* s);
+uint64_t spike_mem_size(spike_t* s);
+
+// physical accesses to memory or devices, as made by the debugger
+int spike_read_mem(spike_t* s, uint64_t addr, size_t len, void* bytes);
+int spike_write_mem(spike_t* s, uint64_t addr, size_t len, const void* bytes);
+
+// run the whole machine for n instructions, switching harts and advancing
+// the timer as spike does
+int spike_step(spike_t* s, size_t n);
+// run only this hart for n instructions
+int spike_step_hart(spike_t* s, size_t hart, size_t n);
+
+int spike_get_pc(spike_t* s, size_t hart, uint64_t* pc);
+int spike_set_pc(spike_t* s, size_t hart, uint64_t pc);
+int spike_get_xreg(spike_t* s, size_t hart, unsigned reg, uint64_t* value);
+int spike_set_xreg(spike_t* s, size_t hart, unsigned reg, uint64_t value);
+// the bits of f<reg>
+int spike_get_freg(spike_t* s, size_t hart, unsigned reg, uint64_t* value);
+int spike_set_freg(spike_t* s, size_t hart, unsigned reg, uint64_t value);
+int spike_get_csr(spike_t* s, size_t hart, unsigned csr, uint64_t* value);
+int spike_set_csr(spike_t* s, size_t hart, unsigned csr, uint64_t value);
+
+// called for each instruction a hart retires; reg is the register it wrote,
+// x0-x31 as 0-31 and f0-f31 as 32-63, or -1 if none.  NULL turns it off.
+typedef void (*spike_commit_fn)(void* arg, size_t hart, uint64_t pc,
+                                uint64_t insn, int reg, uint64_t value);
+void spike_set_commit_callback(spike_t* s, spike_commit_fn fn, void* arg);
+
+// a device at [base, base + size); offsets are from base.  The callbacks
+// return 0 if the access succeeded and nonzero to fault.
+typedef int (*spike_mmio_load_fn)(void* arg, uint64_t offset, size_t len,
+                                  void* bytes);
+typedef int (*spike_mmio_store_fn)(void* arg, uint64_t offset, size_t len,
+                                   const void* bytes);
+int spike_add_mmio(spike_t* s, uint64_t base, uint64_t size,
+                   spike_mmio_load_fn load, spike_mmio_store_fn store,
+                   void* arg);
+
+// see sim_t::snapshot and sim_t::restore
+int spike_snapshot(spike_t* s);
+int spike_restore(spike_t* s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
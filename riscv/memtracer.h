@@ -6,6 +6,7 @@
 #include <cstdint>
 #include <string.h>
 #include <vector>
+#include <algorithm>
 
 enum access_type {
   LOAD,
@@ -21,6 +22,12 @@ class memtracer_t
 
   virtual bool interested_in_range(uint64_t begin, uint64_t end, access_type type) = 0;
   virtual void trace(uint64_t addr, size_t bytes, access_type type) = 0;
+  // what the MMU calls; pc is the instruction making the access, or the
+  // fetch address, for tracers that want it
+  virtual void trace_pc(uint64_t addr, size_t bytes, access_type type, uint64_t pc)
+  {
+    trace(addr, bytes, type);
+  }
 };
 
 class memtracer_list_t : public memtracer_t
@@ -35,14 +42,22 @@ class memtracer_list_t : public memtracer_t
     return false;
   }
   void trace(uint64_t addr, size_t bytes, access_type type)
+  {
+    trace_pc(addr, bytes, type, 0);
+  }
+  void trace_pc(uint64_t addr, size_t bytes, access_type type, uint64_t pc)
   {
     for (std::vector<memtracer_t*>::iterator it = list.begin(); it != list.end(); ++it)
-      (*it)->trace(addr, bytes, type);
+      (*it)->trace_pc(addr, bytes, type, pc);
   }
   void hook(memtracer_t* h)
   {
     list.push_back(h);
   }
+  void unhook(memtracer_t* h)
+  {
+    list.erase(std::remove(list.begin(), list.end(), h), list.end());
+  }
  private:
   std::vector<memtracer_t*> list;
 };
@@ -3,14 +3,17 @@
 #include "mmu.h"
 #include "sim.h"
 #include "processor.h"
+#include <cassert>
 
 mmu_t::mmu_t(sim_t* sim, processor_t* proc)
- : sim(sim), proc(proc),
+ : sim(sim), proc(proc), fault_cause(0), fault_addr(0),
+  trace_loads(false), trace_stores(false), lockstep(false),
   check_triggers_fetch(false),
   check_triggers_load(false),
   check_triggers_store(false),
   matched_trigger(NULL)
 {
+  set_icache_size(DEFAULT_ICACHE_SIZE);
   flush_tlb();
 }
 
@@ -18,10 +21,19 @@ mmu_t::~mmu_t()
 {
 }
 
+void mmu_t::set_icache_size(size_t entries)
+{
+  assert(entries >= ICACHE_ENTRIES && (entries & (entries-1)) == 0);
+  icache.resize(entries);
+  icache_mask = entries - 1;
+  flush_icache();
+}
+
 void mmu_t::flush_icache()
 {
-  for (size_t i = 0; i < ICACHE_ENTRIES; i++)
-    icache[i].tag = -1;
+  for (auto& entry : icache)
+    entry.tag = -1;
+  icache_vpage = 1;
 }
 
 void mmu_t::flush_tlb()
@@ -30,7 +42,47 @@ void mmu_t::flush_tlb()
   memset(tlb_load_tag, -1, sizeof(tlb_load_tag));
   memset(tlb_store_tag, -1, sizeof(tlb_store_tag));
 
-  flush_icache();
+  // the icache is physically tagged, so only the current translation goes
+  icache_vpage = 1;
+}
+
+void mmu_t::flush_icache_page(reg_t paddr)
+{
+  // A run of straight-line code fills consecutive entries from the index of
+  // its first instruction, and never moves ahead of its instructions' own
+  // indices, so a page's decodes all lie in the indices of its addresses.
+  size_t base = icache_index(paddr & ~(reg_t)(PGSIZE-1));
+  size_t n = std::min<size_t>(PGSIZE / PC_ALIGN, icache.size());
+  for (size_t i = 0; i < n; i++) {
+    auto& entry = icache[(base + i) & icache_mask];
+    if ((entry.tag >> PGSHIFT) == (paddr >> PGSHIFT))
+      entry.tag = -1;
+  }
+}
+
+void mmu_t::flush_store_tlb_page(reg_t paddr)
+{
+  for (size_t i = 0; i < TLB_ENTRIES; i++) {
+    if (tlb_store_tag[i] == (reg_t)-1)
+      continue;
+    reg_t vaddr = (tlb_store_tag[i] & ~TLB_FLAGS) << PGSHIFT;
+    if ((sim->mem_to_addr(tlb_data[i] + vaddr) >> PGSHIFT) == (paddr >> PGSHIFT))
+      tlb_store_tag[i] = -1;
+  }
+}
+
+bool mmu_t::refill_icache_page(reg_t vaddr)
+{
+  reg_t paddr;
+  translate_insn_addr(vaddr, &paddr);
+  if (!sim->addr_is_mem(paddr)) {
+    icache_vpage = 1;
+    return false;
+  }
+
+  icache_vpage = vaddr & PGMASK;
+  icache_bias = (paddr & PGMASK) - icache_vpage;
+  return true;
 }
 
 reg_t mmu_t::translate(reg_t addr, access_type type)
@@ -53,8 +105,12 @@ reg_t mmu_t::translate(reg_t addr, access_type type)
   return walk(addr, type, mode) | (addr & (PGSIZE-1));
 }
 
-const uint16_t* mmu_t::fetch_slow_path(reg_t vaddr)
+const uint16_t* mmu_t::fetch_slow_path(reg_t vaddr, reg_t* paddr_out)
 {
+  if (proc)
+    proc->count_event(HPM_SLOW_PATH);
+  if (unlikely(lockstep) && !check_permission(vaddr, FETCH))
+    throw_fault();
   reg_t paddr = translate(vaddr, FETCH);
 
   // mmu_t::walk() returns -1 if it can't find a match. Of course -1 could also
@@ -62,11 +118,15 @@ const uint16_t* mmu_t::fetch_slow_path(reg_t vaddr)
   if (paddr == ~(reg_t) 0 && vaddr != ~(reg_t) 0) {
     throw trap_instruction_access_fault(vaddr);
   }
+  if (paddr_out)
+    *paddr_out = paddr;
 
   if (sim->addr_is_mem(paddr)) {
     refill_tlb(vaddr, paddr, FETCH);
     return (const uint16_t*)sim->addr_to_mem(paddr);
   } else {
+    if (proc)
+      proc->count_event(HPM_MMIO_ACCESS);
     if (!sim->mmio_load(paddr, sizeof fetch_temp, (uint8_t*)&fetch_temp))
       throw trap_instruction_access_fault(vaddr);
     return &fetch_temp;
@@ -99,18 +159,39 @@ reg_t reg_from_bytes(size_t len, const uint8_t* bytes)
   abort();
 }
 
-void mmu_t::load_slow_path(reg_t addr, reg_t len, uint8_t* bytes)
+void mmu_t::throw_fault()
+{
+  switch (fault_cause) {
+    case CAUSE_FAULT_FETCH: throw trap_instruction_access_fault(fault_addr);
+    case CAUSE_MISALIGNED_LOAD: throw trap_load_address_misaligned(fault_addr);
+    case CAUSE_FAULT_LOAD: throw trap_load_access_fault(fault_addr);
+    case CAUSE_MISALIGNED_STORE: throw trap_store_address_misaligned(fault_addr);
+    case CAUSE_FAULT_STORE: throw trap_store_access_fault(fault_addr);
+    default: abort();
+  }
+}
+
+bool mmu_t::load_slow_path(reg_t addr, reg_t len, uint8_t* bytes)
 {
+  if (proc)
+    proc->count_event(HPM_SLOW_PATH);
+  if (unlikely(lockstep) && !check_permission(addr, LOAD))
+    return false;
   reg_t paddr = translate(addr, LOAD);
 
   if (sim->addr_is_mem(paddr)) {
     memcpy(bytes, sim->addr_to_mem(paddr), len);
+    if (trace_loads)
+      trace_access(sim->addr_to_mem(paddr), len, LOAD);
     if (tracer.interested_in_range(paddr, paddr + PGSIZE, LOAD))
-      tracer.trace(paddr, len, LOAD);
+      tracer.trace_pc(paddr, len, LOAD, proc ? proc->state.pc : 0);
     else
       refill_tlb(addr, paddr, LOAD);
-  } else if (!sim->mmio_load(paddr, len, bytes)) {
-    throw trap_load_access_fault(addr);
+  } else {
+    if (proc)
+      proc->count_event(HPM_MMIO_ACCESS);
+    if (!sim->mmio_load(paddr, len, bytes))
+      return fault(CAUSE_FAULT_LOAD, addr);
   }
 
   if (!matched_trigger) {
@@ -119,10 +200,15 @@ void mmu_t::load_slow_path(reg_t addr, reg_t len, uint8_t* bytes)
     if (matched_trigger)
       throw *matched_trigger;
   }
+  return true;
 }
 
-void mmu_t::store_slow_path(reg_t addr, reg_t len, const uint8_t* bytes)
+bool mmu_t::store_slow_path(reg_t addr, reg_t len, const uint8_t* bytes)
 {
+  if (proc)
+    proc->count_event(HPM_SLOW_PATH);
+  if (unlikely(lockstep) && !check_permission(addr, STORE))
+    return false;
   reg_t paddr = translate(addr, STORE);
 
   if (!matched_trigger) {
@@ -133,32 +219,88 @@ void mmu_t::store_slow_path(reg_t addr, reg_t len, const uint8_t* bytes)
   }
 
   if (sim->addr_is_mem(paddr)) {
+    sim->page_written(paddr);
     memcpy(sim->addr_to_mem(paddr), bytes, len);
+    sim->code_page_written(paddr);
+    sim->reserved_page_written(proc, paddr);
+    if (trace_stores)
+      trace_access(sim->addr_to_mem(paddr), len, STORE);
     if (tracer.interested_in_range(paddr, paddr + PGSIZE, STORE))
-      tracer.trace(paddr, len, STORE);
-    else
+      tracer.trace_pc(paddr, len, STORE, proc ? proc->state.pc : 0);
+    else if (!sim->addr_is_htif(paddr) && !sim->page_reserved(paddr))
+      refill_tlb(addr, paddr, STORE);
+    // a target write to tohost/fromhost wakes the host at the next quantum
+    if (proc && sim->addr_is_htif(paddr))
+      sim->htif_pending = true;
+  } else {
+    if (proc)
+      proc->count_event(HPM_MMIO_ACCESS);
+    if (!sim->mmio_store(paddr, len, bytes))
+      return fault(CAUSE_FAULT_STORE, addr);
+  }
+  return true;
+}
+
+// the host address an AMO of len bytes at addr may update in place, or NULL
+// if it must be made as a load and a store
+char* mmu_t::amo_slow_path(reg_t addr, reg_t len)
+{
+  if (check_triggers_load || check_triggers_store)
+    return NULL;
+
+  reg_t vpn = addr >> PGSHIFT;
+  char* host;
+  if (tlb_store_tag[vpn % TLB_ENTRIES] == (vpn | TLB_TRACE)) {
+    host = tlb_data[vpn % TLB_ENTRIES] + addr;
+  } else {
+    if (proc)
+      proc->count_event(HPM_SLOW_PATH);
+    if (unlikely(lockstep) && !check_permission(addr, STORE))
+      throw_fault();
+    reg_t paddr = translate(addr, STORE);
+
+    if (!sim->addr_is_mem(paddr) || sim->addr_is_htif(paddr) ||
+        tracer.interested_in_range(paddr, paddr + PGSIZE, LOAD) ||
+        tracer.interested_in_range(paddr, paddr + PGSIZE, STORE))
+      return NULL;
+
+    sim->page_written(paddr);
+    sim->code_page_written(paddr);
+    sim->reserved_page_written(proc, paddr);
+    if (!sim->page_reserved(paddr))
       refill_tlb(addr, paddr, STORE);
-  } else if (!sim->mmio_store(paddr, len, bytes)) {
-    throw trap_store_access_fault(addr);
+    host = sim->addr_to_mem(paddr);
   }
+
+  if (trace_loads)
+    trace_access(host, len, LOAD);
+  if (trace_stores)
+    trace_access(host, len, STORE);
+  return host;
 }
 
 void mmu_t::refill_tlb(reg_t vaddr, reg_t paddr, access_type type)
 {
+  if (proc)
+    proc->count_event(type == FETCH ? HPM_ITLB_REFILL : HPM_DTLB_REFILL);
+
   reg_t idx = (vaddr >> PGSHIFT) % TLB_ENTRIES;
   reg_t expected_tag = vaddr >> PGSHIFT;
 
-  if ((tlb_load_tag[idx] & ~TLB_CHECK_TRIGGERS) != expected_tag)
+  if ((tlb_load_tag[idx] & ~TLB_FLAGS) != expected_tag)
     tlb_load_tag[idx] = -1;
-  if ((tlb_store_tag[idx] & ~TLB_CHECK_TRIGGERS) != expected_tag)
+  if ((tlb_store_tag[idx] & ~TLB_FLAGS) != expected_tag)
     tlb_store_tag[idx] = -1;
-  if ((tlb_insn_tag[idx] & ~TLB_CHECK_TRIGGERS) != expected_tag)
+  if ((tlb_insn_tag[idx] & ~TLB_FLAGS) != expected_tag)
     tlb_insn_tag[idx] = -1;
 
   if ((check_triggers_fetch && type == FETCH) ||
       (check_triggers_load && type == LOAD) ||
       (check_triggers_store && type == STORE))
     expected_tag |= TLB_CHECK_TRIGGERS;
+  if ((trace_loads && type == LOAD) ||
+      ((trace_loads || trace_stores) && type == STORE))
+    expected_tag |= TLB_TRACE;
 
   if (type == FETCH) tlb_insn_tag[idx] = expected_tag;
   else if (type == STORE) tlb_store_tag[idx] = expected_tag;
@@ -178,6 +320,8 @@ reg_t mmu_t::walk(reg_t addr, access_type type, reg_t mode)
     default: abort();
   }
 
+  proc->count_event(HPM_PAGE_WALK);
+
   bool supervisor = mode == PRV_S;
   bool pum = get_field(proc->state.mstatus, MSTATUS_PUM);
   bool mxr = get_field(proc->state.mstatus, MSTATUS_MXR);
@@ -215,6 +359,7 @@ reg_t mmu_t::walk(reg_t addr, access_type type, reg_t mode)
       break;
     } else {
       // set accessed and possibly dirty bits.
+      sim->page_written(pte_addr);
       *(uint32_t*)ppte |= PTE_A | ((type == STORE) * PTE_D);
       // for superpage mappings, make a fake leaf PTE for the TLB's benefit.
       reg_t vpn = addr >> PGSHIFT;
@@ -229,9 +374,37 @@ reg_t mmu_t::walk(reg_t addr, access_type type, reg_t mode)
 void mmu_t::register_memtracer(memtracer_t* t)
 {
   flush_tlb();
+  flush_icache();
   tracer.hook(t);
 }
 
+void mmu_t::unregister_memtracer(memtracer_t* t)
+{
+  flush_tlb();
+  flush_icache();
+  tracer.unhook(t);
+}
+
+void mmu_t::register_access_tracer(memtracer_t* t)
+{
+  access_tracers.hook(t);
+  update_access_tracing();
+}
+
+void mmu_t::unregister_access_tracer(memtracer_t* t)
+{
+  access_tracers.unhook(t);
+  update_access_tracing();
+}
+
+// entries filled before the change are tagged for the old tracers
+void mmu_t::update_access_tracing()
+{
+  trace_loads = access_tracers.interested_in_range(0, -1, LOAD);
+  trace_stores = access_tracers.interested_in_range(0, -1, STORE);
+  flush_tlb();
+}
+
 void mmu_t::set_permission(size_t addr, reg_t tag, reg_t meta, tlb_type_t tpe) {
   tlb_t* tlb = tpe == ITLB ? &itlb : &dtlb;
   reg_t old_tag = tlb->tags[addr];
@@ -239,13 +412,32 @@ void mmu_t::set_permission(size_t addr, reg_t tag, reg_t meta, tlb_type_t tpe) {
   if (it != tlb->tag_map.end()) {
     tlb->tag_map.erase(it);
   }
+  flush_permission_tlb(old_tag, tpe);
+  flush_permission_tlb(tag, tpe);
 
   tlb->meta[addr] = meta;
   tlb->tags[addr] = tag;
   tlb->tag_map[tag] = addr;
 }
 
+// A permission tag is a VPN with its sign-extended top bits dropped, so it
+// shares its TLB index with the pages it covers.  Those entries were
+// checked against the old permission when they were refilled.
+void mmu_t::flush_permission_tlb(reg_t tag, tlb_type_t tpe) {
+  if (tag == (reg_t)-1)
+    return;
+  reg_t idx = tag % TLB_ENTRIES;
+  if (tpe == ITLB) {
+    tlb_insn_tag[idx] = -1;
+    icache_vpage = 1;
+  } else {
+    tlb_load_tag[idx] = -1;
+    tlb_store_tag[idx] = -1;
+  }
+}
+
 void mmu_t::flush_permission() {
+  flush_tlb();
   itlb.tag_map.clear();
   dtlb.tag_map.clear();
   std::fill(itlb.meta.begin(), itlb.meta.end(), 0);
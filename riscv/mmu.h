@@ -27,8 +27,7 @@ struct insn_fetch_t
 };
 
 struct icache_entry_t {
-  reg_t tag;
-  reg_t pad;
+  reg_t tag; // physical address of the instruction, or -1 if invalid
   insn_fetch_t data;
 };
 
@@ -66,26 +65,39 @@ public:
   mmu_t(sim_t* sim, processor_t* proc);
   ~mmu_t();
 
-  // template for functions that load an aligned value from memory
+  // template for functions that load an aligned value from memory.  The
+  // try_ form returns false on a misaligned address or an access fault,
+  // having recorded it for post_fault or throw_fault, so an instruction
+  // handler can post it (see MMU_LOAD) rather than unwind.  Triggers still
+  // throw.
   #define load_func(type) \
-    inline type##_t load_##type(reg_t addr) { \
-      if (addr & (sizeof(type##_t)-1)) \
-        throw trap_load_address_misaligned(addr); \
+    inline bool try_load_##type(reg_t addr, type##_t* res) { \
+      if (unlikely(addr & (sizeof(type##_t)-1))) \
+        return fault(CAUSE_MISALIGNED_LOAD, addr); \
       reg_t vpn = addr >> PGSHIFT; \
-      if (likely(lockstep)) check_permission(addr, LOAD); \
-      if (likely(tlb_load_tag[vpn % TLB_ENTRIES] == vpn)) \
-        return *(type##_t*)(tlb_data[vpn % TLB_ENTRIES] + addr); \
-      if (unlikely(tlb_load_tag[vpn % TLB_ENTRIES] == (vpn | TLB_CHECK_TRIGGERS))) { \
+      reg_t tag = tlb_load_tag[vpn % TLB_ENTRIES]; \
+      if (likely(tag == vpn)) { \
+        *res = *(type##_t*)(tlb_data[vpn % TLB_ENTRIES] + addr); \
+        return true; \
+      } \
+      if (unlikely((tag & ~TLB_FLAGS) == vpn)) { \
+        if (tag & TLB_TRACE) \
+          trace_access(tlb_data[vpn % TLB_ENTRIES] + addr, sizeof(type##_t), LOAD); \
         type##_t data = *(type##_t*)(tlb_data[vpn % TLB_ENTRIES] + addr); \
-        if (!matched_trigger) { \
+        if ((tag & TLB_CHECK_TRIGGERS) && !matched_trigger) { \
           matched_trigger = trigger_exception(OPERATION_LOAD, addr, data); \
           if (matched_trigger) \
             throw *matched_trigger; \
         } \
-        return data; \
+        *res = data; \
+        return true; \
       } \
+      return load_slow_path(addr, sizeof(type##_t), (uint8_t*)res); \
+    } \
+    inline type##_t load_##type(reg_t addr) { \
       type##_t res; \
-      load_slow_path(addr, sizeof(type##_t), (uint8_t*)&res); \
+      if (unlikely(!try_load_##type(addr, &res))) \
+        throw_fault(); \
       return res; \
     }
 
@@ -101,41 +113,87 @@ public:
   load_func(int32)
   load_func(int64)
 
-  // template for functions that store an aligned value to memory
+  // template for functions that store an aligned value to memory, with a
+  // try_ form as for loads
   #define store_func(type) \
-    void store_##type(reg_t addr, type##_t val) { \
-      if (addr & (sizeof(type##_t)-1)) \
-        throw trap_store_address_misaligned(addr); \
+    inline bool try_store_##type(reg_t addr, type##_t val) { \
+      if (unlikely(addr & (sizeof(type##_t)-1))) \
+        return fault(CAUSE_MISALIGNED_STORE, addr); \
       reg_t vpn = addr >> PGSHIFT; \
-      if (likely(lockstep)) check_permission(addr, STORE); \
-      if (likely(tlb_store_tag[vpn % TLB_ENTRIES] == vpn)) \
+      reg_t tag = tlb_store_tag[vpn % TLB_ENTRIES]; \
+      if (likely(tag == vpn)) { \
         *(type##_t*)(tlb_data[vpn % TLB_ENTRIES] + addr) = val; \
-      else if (unlikely(tlb_store_tag[vpn % TLB_ENTRIES] == (vpn | TLB_CHECK_TRIGGERS))) { \
-        if (!matched_trigger) { \
+        return true; \
+      } \
+      if (unlikely((tag & ~TLB_FLAGS) == vpn)) { \
+        if ((tag & TLB_CHECK_TRIGGERS) && !matched_trigger) { \
           matched_trigger = trigger_exception(OPERATION_STORE, addr, val); \
           if (matched_trigger) \
             throw *matched_trigger; \
         } \
+        if (tag & TLB_TRACE) \
+          trace_access(tlb_data[vpn % TLB_ENTRIES] + addr, sizeof(type##_t), STORE); \
         *(type##_t*)(tlb_data[vpn % TLB_ENTRIES] + addr) = val; \
+        return true; \
       } \
-      else \
-        store_slow_path(addr, sizeof(type##_t), (const uint8_t*)&val); \
+      return store_slow_path(addr, sizeof(type##_t), (const uint8_t*)&val); \
+    } \
+    void store_##type(reg_t addr, type##_t val) { \
+      if (unlikely(!try_store_##type(addr, val))) \
+        throw_fault(); \
     }
 
-  // template for functions that perform an atomic memory operation
+  // template for functions that perform an atomic memory operation.  The
+  // address is translated once, for a store, and the operation is applied
+  // in place with a host compare-and-swap, so it is atomic to anything else
+  // sharing the memory too (see sim_t::map_mem).  MMIO, addresses a
+  // memtracer watches and ones with triggers set take a load and a store
+  // instead.  amo_slow_path reports accesses to the access tracers.
   #define amo_func(type) \
     template<typename op> \
     type##_t amo_##type(reg_t addr, op f) { \
       if (addr & (sizeof(type##_t)-1)) \
         throw trap_store_address_misaligned(addr); \
-      try { \
-        auto lhs = load_##type(addr); \
-        store_##type(addr, f(lhs)); \
-        return lhs; \
-      } catch (trap_load_access_fault& t) { \
-        /* AMO faults should be reported as store faults */ \
-        throw trap_store_access_fault(t.get_badaddr()); \
+      reg_t vpn = addr >> PGSHIFT; \
+      type##_t* host; \
+      if (likely(tlb_store_tag[vpn % TLB_ENTRIES] == vpn)) \
+        host = (type##_t*)(tlb_data[vpn % TLB_ENTRIES] + addr); \
+      else if (!(host = (type##_t*)amo_slow_path(addr, sizeof(type##_t)))) { \
+        try { \
+          auto lhs = load_##type(addr); \
+          store_##type(addr, f(lhs)); \
+          return lhs; \
+        } catch (trap_load_access_fault& t) { \
+          /* AMO faults should be reported as store faults */ \
+          throw trap_store_access_fault(t.get_badaddr()); \
+        } \
       } \
+      type##_t lhs = __atomic_load_n(host, __ATOMIC_RELAXED); \
+      while (!__atomic_compare_exchange_n(host, &lhs, f(lhs), true, \
+                                          __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) \
+        ; \
+      return lhs; \
+    }
+
+  // LR: a load that also reserves the block of memory holding it
+  #define load_reserved_func(type) \
+    type##_t load_reserved_##type(reg_t addr) { \
+      type##_t res = load_##type(addr); \
+      acquire_load_reservation(addr); \
+      return res; \
+    }
+
+  // SC: a store made only if the hart still holds a reservation on the
+  // block, which it gives up either way; true if the store was made
+  #define store_conditional_func(type) \
+    bool store_conditional_##type(reg_t addr, type##_t val) { \
+      if (addr & (sizeof(type##_t)-1)) \
+        throw trap_store_address_misaligned(addr); \
+      bool ok = check_load_reservation(addr); \
+      if (ok) \
+        store_##type(addr, val); \
+      proc->yield_load_reservation(); \
+      return ok; \
     }
 
   // store value to memory at aligned address
@@ -148,17 +206,44 @@ public:
   amo_func(uint32)
   amo_func(uint64)
 
+  // load-reserved and store-conditional at an aligned address
+  load_reserved_func(int32)
+  load_reserved_func(int64)
+  store_conditional_func(uint32)
+  store_conditional_func(uint64)
+
+  // the host address of the len bytes at addr if they lie in one page whose
+  // translation for loads (or stores) is in the TLB, else NULL; lets vector
+  // instructions copy a run of elements at once when they needn't be traced
+  // or checked for triggers, as a flagged tag doesn't match
+  char* tlb_load_ptr(reg_t addr, reg_t len) {
+    reg_t vpn = addr >> PGSHIFT;
+    if (likely(tlb_load_tag[vpn % TLB_ENTRIES] == vpn && ((addr + len - 1) >> PGSHIFT) == vpn))
+      return tlb_data[vpn % TLB_ENTRIES] + addr;
+    return NULL;
+  }
+  char* tlb_store_ptr(reg_t addr, reg_t len) {
+    reg_t vpn = addr >> PGSHIFT;
+    if (likely(tlb_store_tag[vpn % TLB_ENTRIES] == vpn && ((addr + len - 1) >> PGSHIFT) == vpn))
+      return tlb_data[vpn % TLB_ENTRIES] + addr;
+    return NULL;
+  }
+
+  // the fetch loop in processor_t::step is unrolled ICACHE_ENTRIES ways;
+  // the icache itself may be any power-of-two multiple of that size
   static const reg_t ICACHE_ENTRIES = 1024;
+  static const size_t DEFAULT_ICACHE_SIZE = 8192;
+  void set_icache_size(size_t entries);
 
-  inline size_t icache_index(reg_t addr)
+  inline size_t icache_index(reg_t paddr)
   {
-    return (addr / PC_ALIGN) % ICACHE_ENTRIES;
+    return (paddr / PC_ALIGN) & icache_mask;
   }
 
   inline icache_entry_t* refill_icache(reg_t addr, icache_entry_t* entry)
   {
-    const uint16_t* iaddr = translate_insn_addr(addr);
-    insn_bits_t insn = *iaddr;
+    reg_t paddr;
+    insn_bits_t insn = *translate_insn_addr(addr, &paddr);
     int length = insn_length(insn);
 
     if (likely(length == 4)) {
@@ -175,22 +260,30 @@ public:
       insn |= (insn_bits_t)*(const uint16_t*)translate_insn_addr(addr + 2) << 16;
     }
 
+    proc->count_event(HPM_ICACHE_REFILL);
     insn_fetch_t fetch = {proc->decode_insn(insn), insn};
-    entry->tag = addr;
+    entry->tag = paddr;
     entry->data = fetch;
 
-    reg_t paddr = sim->mem_to_addr((char*)iaddr);
+    // don't cache instructions fetched from MMIO or spanning two pages
+    if (!sim->addr_is_mem(paddr) || ((addr ^ (addr + length - 1)) & PGMASK))
+      entry->tag = -1;
     if (tracer.interested_in_range(paddr, paddr + 1, FETCH)) {
       entry->tag = -1;
-      tracer.trace(paddr, length, FETCH);
+      tracer.trace_pc(paddr, length, FETCH, addr);
     }
+    if (entry->tag != (reg_t)-1)
+      sim->mark_code_page(paddr);
     return entry;
   }
 
   inline icache_entry_t* access_icache(reg_t addr)
   {
-    icache_entry_t* entry = &icache[icache_index(addr)];
-    if (likely(entry->tag == addr))
+    if (unlikely((addr & PGMASK) != icache_vpage) && !refill_icache_page(addr))
+      return refill_icache(addr, &icache[icache_index(addr)]);
+    reg_t paddr = addr + icache_bias;
+    icache_entry_t* entry = &icache[icache_index(paddr)];
+    if (likely(entry->tag == paddr))
       return entry;
     return refill_icache(addr, entry);
   }
@@ -203,12 +296,45 @@ public:
 
   void flush_tlb();
   void flush_icache();
+  void flush_icache_page(reg_t paddr); // drop decodes from this physical page
+  void flush_store_tlb_page(reg_t paddr); // make stores to it take the slow path
+
+  // the fault a try_ access returned false for: throw it, or post it for
+  // the step loop to take, as post_trap does
+  [[noreturn]] void throw_fault();
+  void post_fault(state_t* state) {
+    state->pending_trap = fault_cause;
+    state->pending_badaddr = fault_addr;
+  }
+
+  // the physical address an instruction at addr was fetched from, before
+  // it runs and perhaps changes the translation
+  reg_t fetch_addr(reg_t addr) {
+    reg_t vpn = addr >> PGSHIFT;
+    if (likely((tlb_insn_tag[vpn % TLB_ENTRIES] & ~TLB_FLAGS) == vpn))
+      return sim->mem_to_addr(tlb_data[vpn % TLB_ENTRIES] + addr);
+    return translate(addr, FETCH);
+  }
 
   void register_memtracer(memtracer_t*);
+  void unregister_memtracer(memtracer_t*);
+  // unlike a memtracer, an access tracer sees the loads and stores to
+  // memory it is interested in without taking them off the TLB, as an
+  // instruction trace or a store ring must.  The TLB entries filled while
+  // one wants their type are tagged with TLB_TRACE, so hits on untraced
+  // ones don't test for it.  Tracers are called for any access to a tagged
+  // entry and ignore the types they don't want.
+  void register_access_tracer(memtracer_t*);
+  void unregister_access_tracer(memtracer_t*);
 
   // By Donggyu
+  // in lockstep, accesses are checked against the RTL's permissions when
+  // they refill the TLB, and changing a permission drops the TLB entries
+  // it covers, so hits need no check
   void set_lockstep(bool value) {
     lockstep = value;
+    flush_tlb();
+    flush_icache(); // instructions decode differently when commits are logged
   }
   void set_permission(size_t addr, reg_t tag, reg_t meta, tlb_type_t tpe);
   void flush_permission();
@@ -217,20 +343,46 @@ private:
   sim_t* sim;
   processor_t* proc;
   memtracer_list_t tracer;
+  memtracer_list_t access_tracers;
+  reg_t fault_cause, fault_addr; // see throw_fault
+  bool fault(reg_t cause, reg_t addr) {
+    fault_cause = cause;
+    fault_addr = addr;
+    return false;
+  }
+  bool trace_loads, trace_stores; // some access tracer wants them
   uint16_t fetch_temp;
 
+  // the TLB only maps memory, so its host pointers convert back to one
+  void trace_access(char* host, reg_t len, access_type type) {
+    access_tracers.trace_pc(sim->mem_to_addr(host), len, type, proc ? proc->state.pc : 0);
+  }
+  void update_access_tracing();
+
   // By Donggyu
   bool lockstep;
   tlb_t itlb, dtlb;
+  void flush_permission_tlb(reg_t tag, tlb_type_t tpe);
 
-  // implement an instruction cache for simulator performance
-  icache_entry_t icache[ICACHE_ENTRIES];
+  // implement an instruction cache for simulator performance.  It is tagged
+  // by physical address, so it survives TLB flushes; icache_vpage is the
+  // virtual page last fetched from and icache_bias its physical offset.
+  std::vector<icache_entry_t> icache;
+  reg_t icache_mask;
+  reg_t icache_vpage;
+  reg_t icache_bias;
+  bool refill_icache_page(reg_t vaddr);
 
   // implement a TLB for simulator performance
   static const reg_t TLB_ENTRIES = 256;
   // If a TLB tag has TLB_CHECK_TRIGGERS set, then the MMU must check for a
   // trigger match before completing an access.
   static const reg_t TLB_CHECK_TRIGGERS = reg_t(1) << 63;
+  // If it has TLB_TRACE set, the access is reported to the access tracers.
+  // AMOs update memory through store entries, so those are tagged if any
+  // access tracer wants loads or stores.
+  static const reg_t TLB_TRACE = reg_t(1) << 62;
+  static const reg_t TLB_FLAGS = TLB_CHECK_TRIGGERS | TLB_TRACE;
   char* tlb_data[TLB_ENTRIES];
   reg_t tlb_insn_tag[TLB_ENTRIES];
   reg_t tlb_load_tag[TLB_ENTRIES];
@@ -244,12 +396,14 @@ private:
   reg_t walk(reg_t addr, access_type type, reg_t prv);
 
   // handle uncommon cases: TLB misses, page faults, MMIO
-  const uint16_t* fetch_slow_path(reg_t addr);
-  void load_slow_path(reg_t addr, reg_t len, uint8_t* bytes);
-  void store_slow_path(reg_t addr, reg_t len, const uint8_t* bytes);
+  const uint16_t* fetch_slow_path(reg_t addr, reg_t* paddr);
+  bool load_slow_path(reg_t addr, reg_t len, uint8_t* bytes);
+  bool store_slow_path(reg_t addr, reg_t len, const uint8_t* bytes);
+  char* amo_slow_path(reg_t addr, reg_t len);
   reg_t translate(reg_t addr, access_type type);
 
-  inline void check_permission(reg_t vaddr, access_type type) {
+  // false, with the fault recorded, if the RTL wouldn't allow the access
+  inline bool check_permission(reg_t vaddr, access_type type) {
     reg_t mode = proc->state.prv;
     if (type != FETCH) {
       if (!proc->state.dcsr.cause && get_field(proc->state.mstatus, MSTATUS_MPRV))
@@ -257,7 +411,7 @@ private:
     }
     if (get_field(proc->state.mstatus, MSTATUS_VM) == VM_MBARE)
       mode = PRV_M;
-    if (mode == PRV_M) return;
+    if (mode == PRV_M) return true;
 
     bool supervisor = mode == PRV_S;
     bool pum = get_field(proc->state.mstatus, MSTATUS_PUM);
@@ -270,7 +424,7 @@ private:
       case VM_SV48: tag &= ((1ULL << 36) - 1);
     }
     auto match = tlb->tag_map.find(tag);
-    if (match == tlb->tag_map.end()) return;
+    if (match == tlb->tag_map.end()) return true;
 
     size_t addr = match->second;
     reg_t meta = tlb->meta[addr];
@@ -280,48 +434,73 @@ private:
       case FETCH: {
         bool xcpt_if = no_priv || no_valid ||
           !(meta & PTE_X);
-        if (xcpt_if) {
-          throw trap_instruction_access_fault(vaddr);
-        }
+        if (xcpt_if)
+          return fault(CAUSE_FAULT_FETCH, vaddr);
         break;
       }
       case LOAD: {
         bool xcpt_ld = no_priv || no_valid ||
           (!(meta & PTE_R) && !(mxr && (meta & PTE_X)));
-        if (xcpt_ld) {
-          throw trap_load_access_fault(vaddr);
-        }
+        if (xcpt_ld)
+          return fault(CAUSE_FAULT_LOAD, vaddr);
         break;
       }
       case STORE: {
         // miss if dirty is off
         bool miss = !no_priv && !no_valid &&
           (meta & PTE_W) && !(meta & PTE_D);
-        if (miss) return;
+        if (miss) return true;
         bool xcpt_st = no_priv || no_valid ||
           (!((meta & PTE_R) && (meta & PTE_W)));
-        if (xcpt_st) {
-          throw trap_store_access_fault(vaddr);
-        }
+        if (xcpt_st)
+          return fault(CAUSE_FAULT_STORE, vaddr);
         break;
       }
     }
+    return true;
   } 
 
-  // ITLB lookup
-  inline const uint16_t* translate_insn_addr(reg_t addr) {
+  // the physical address of a load (or store) at addr, from the TLB if the
+  // access has just filled it
+  reg_t access_paddr(reg_t addr, access_type type) {
     reg_t vpn = addr >> PGSHIFT;
-    if (likely(lockstep)) check_permission(addr, FETCH);
-    if (likely(tlb_insn_tag[vpn % TLB_ENTRIES] == vpn))
-      return (uint16_t*)(tlb_data[vpn % TLB_ENTRIES] + addr);
+    reg_t tag = type == STORE ? tlb_store_tag[vpn % TLB_ENTRIES] : tlb_load_tag[vpn % TLB_ENTRIES];
+    if ((tag & ~TLB_FLAGS) == vpn)
+      return sim->mem_to_addr(tlb_data[vpn % TLB_ENTRIES] + addr);
+    return translate(addr, type);
+  }
+
+  void acquire_load_reservation(reg_t addr) {
+    reg_t paddr = access_paddr(addr, LOAD);
+    proc->state.load_reservation = paddr & ~(sim_t::RESERVATION_BYTES - 1);
+  }
+
+  bool check_load_reservation(reg_t addr) {
+    reg_t block = proc->state.load_reservation;
+    return block != (reg_t)-1 &&
+           (access_paddr(addr, STORE) & ~(sim_t::RESERVATION_BYTES - 1)) == block;
+  }
+
+  // ITLB lookup; also gives the physical address if paddr isn't NULL.
+  // The TLB only maps memory, so its host pointers convert back to one.
+  inline const uint16_t* translate_insn_addr(reg_t addr, reg_t* paddr = NULL) {
+    reg_t vpn = addr >> PGSHIFT;
+    if (likely(tlb_insn_tag[vpn % TLB_ENTRIES] == vpn)) {
+      uint16_t* ptr = (uint16_t*)(tlb_data[vpn % TLB_ENTRIES] + addr);
+      if (paddr)
+        *paddr = sim->mem_to_addr((char*)ptr);
+      return ptr;
+    }
     if (unlikely(tlb_insn_tag[vpn % TLB_ENTRIES] == (vpn | TLB_CHECK_TRIGGERS))) {
       uint16_t* ptr = (uint16_t*)(tlb_data[vpn % TLB_ENTRIES] + addr);
       int match = proc->trigger_match(OPERATION_EXECUTE, addr, *ptr);
       if (match >= 0)
         throw trigger_matched_t(match, OPERATION_EXECUTE, addr, *ptr);
+      if (paddr)
+        *paddr = sim->mem_to_addr((char*)ptr);
       return ptr;
     }
-    return fetch_slow_path(addr);
+    return fetch_slow_path(addr, paddr);
   }
 
   inline trigger_matched_t *trigger_exception(trigger_operation_t operation,
@@ -0,0 +1,151 @@
+// See LICENSE for license details.
+
+#include "prefetcher.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+static void help()
+{
+  std::cerr << "Prefetcher configurations must be one of" << std::endl;
+  std::cerr << "  next-line[:degree]" << std::endl;
+  std::cerr << "  stride[:degree[:entries]]" << std::endl;
+  std::cerr << "  stream[:buffers[:depth]]" << std::endl;
+  std::cerr << "where all of the numbers are positive integers." << std::endl;
+  exit(1);
+}
+
+static size_t ilog2(size_t x)
+{
+  size_t n = 0;
+  while (x > 1)
+    x >>= 1, n++;
+  return n;
+}
+
+prefetcher_t* prefetcher_t::construct(const char* config, size_t linesz)
+{
+  const char* colon = strchr(config, ':');
+  std::string kind(config, colon ? colon : config + strlen(config));
+  size_t args[2] = {0, 0};
+  for (size_t i = 0; colon && i < 2; i++) {
+    args[i] = atoi(colon + 1);
+    if (args[i] == 0)
+      help();
+    colon = strchr(colon + 1, ':');
+  }
+  if (colon)
+    help();
+
+  if (kind == "next-line")
+    return new next_line_prefetcher_t(linesz, args[0] ? args[0] : 1);
+  if (kind == "stride")
+    return new stride_prefetcher_t(linesz, args[0] ? args[0] : 2,
+                                   args[1] ? args[1] : 64);
+  if (kind == "stream")
+    return new stream_prefetcher_t(linesz, args[0] ? args[0] : 4,
+                                   args[1] ? args[1] : 4);
+  help();
+  return NULL;
+}
+
+next_line_prefetcher_t::next_line_prefetcher_t(size_t linesz, size_t degree)
+  : line_shift(ilog2(linesz)), degree(degree)
+{
+}
+
+void next_line_prefetcher_t::access(uint64_t addr, uint64_t pc, bool trigger,
+                                    uint64_t now, std::vector<uint64_t>& fetch)
+{
+  if (!trigger)
+    return;
+  for (size_t i = 1; i <= degree; i++)
+    fetch.push_back((addr >> line_shift) + i);
+}
+
+stride_prefetcher_t::stride_prefetcher_t(size_t linesz, size_t degree, size_t entries)
+  : line_shift(ilog2(linesz)), degree(degree), table(entries)
+{
+}
+
+void stride_prefetcher_t::access(uint64_t addr, uint64_t pc, bool trigger,
+                                 uint64_t now, std::vector<uint64_t>& fetch)
+{
+  if (pc == 0)
+    return;
+
+  entry_t& e = table[(pc >> 1) % table.size()];
+  if (e.pc != pc) {
+    e.pc = pc;
+    e.addr = addr;
+    e.stride = 0;
+    e.confidence = 0;
+    return;
+  }
+
+  int64_t stride = addr - e.addr;
+  e.addr = addr;
+  if (stride == e.stride) {
+    if (e.confidence < 3)
+      e.confidence++;
+  } else if (e.confidence > 0) {
+    e.confidence--;
+  } else {
+    e.stride = stride;
+  }
+
+  if (e.confidence < 2 || e.stride == 0)
+    return;
+
+  uint64_t line = addr >> line_shift;
+  for (size_t i = 1; i <= degree; i++) {
+    uint64_t target = (addr + i * e.stride) >> line_shift;
+    if (target != line && (fetch.empty() || fetch.back() != target))
+      fetch.push_back(target);
+  }
+}
+
+stream_prefetcher_t::stream_prefetcher_t(size_t linesz, size_t nbuffers, size_t depth)
+  : line_shift(ilog2(linesz)), depth(depth), buffers(nbuffers), last_taken(-1)
+{
+}
+
+void stream_prefetcher_t::access(uint64_t addr, uint64_t pc, bool trigger,
+                                 uint64_t now, std::vector<uint64_t>& fetch)
+{
+  uint64_t line = addr >> line_shift;
+  if (!trigger || line == last_taken)
+    return;
+
+  buffer_t* lru = &buffers[0];
+  for (auto& b : buffers)
+    if (b.last_use < lru->last_use)
+      lru = &b;
+
+  lru->lines.clear();
+  lru->last_use = now;
+  for (size_t i = 1; i <= depth; i++) {
+    lru->lines.push_back(std::make_pair(line + i, now));
+    fetch.push_back(line + i);
+  }
+  lru->next = line + depth + 1;
+}
+
+bool stream_prefetcher_t::take(uint64_t line, uint64_t now, uint64_t& issued,
+                               std::vector<uint64_t>& fetch)
+{
+  for (auto& b : buffers) {
+    if (b.lines.empty() || b.lines.front().first != line)
+      continue;
+
+    issued = b.lines.front().second;
+    b.lines.pop_front();
+    b.lines.push_back(std::make_pair(b.next, now));
+    fetch.push_back(b.next++);
+    b.last_use = now;
+    last_taken = line;
+    return true;
+  }
+  return false;
+}
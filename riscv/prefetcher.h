@@ -0,0 +1,99 @@
+// See LICENSE for license details.
+
+#ifndef _RISCV_PREFETCHER_H
+#define _RISCV_PREFETCHER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <deque>
+
+// A prefetcher attached to a cache_sim_t.  The cache shows it every demand
+// access and issues the lines it asks for; the cache also keeps the
+// statistics, so a prefetcher only has to decide what to fetch.
+class prefetcher_t
+{
+ public:
+  virtual ~prefetcher_t() {}
+
+  // a demand access to addr by the instruction at pc (0 if unknown) at time
+  // now, counted in accesses to the cache.  trigger is set on misses and on
+  // the first use of a prefetched line.  Lines to fetch go on the end of fetch.
+  virtual void access(uint64_t addr, uint64_t pc, bool trigger, uint64_t now,
+                      std::vector<uint64_t>& fetch) = 0;
+
+  // Prefetchers that hold lines in buffers of their own rather than in the
+  // cache: take line out of a buffer after a cache miss, setting issued to
+  // the time it was fetched.
+  virtual bool has_buffer() { return false; }
+  virtual bool take(uint64_t line, uint64_t now, uint64_t& issued,
+                    std::vector<uint64_t>& fetch) { return false; }
+
+  // config is next-line[:N], stride[:N[:entries]] or stream[:N[:depth]]
+  static prefetcher_t* construct(const char* config, size_t linesz);
+};
+
+// fetch the next N lines after a miss or a hit on a prefetched line
+class next_line_prefetcher_t : public prefetcher_t
+{
+ public:
+  next_line_prefetcher_t(size_t linesz, size_t degree);
+  void access(uint64_t addr, uint64_t pc, bool trigger, uint64_t now,
+              std::vector<uint64_t>& fetch);
+
+ private:
+  size_t line_shift;
+  size_t degree;
+};
+
+// a reference prediction table: each load or store instruction that keeps
+// the same stride gets the next N strides ahead of it fetched
+class stride_prefetcher_t : public prefetcher_t
+{
+ public:
+  stride_prefetcher_t(size_t linesz, size_t degree, size_t entries);
+  void access(uint64_t addr, uint64_t pc, bool trigger, uint64_t now,
+              std::vector<uint64_t>& fetch);
+
+ private:
+  struct entry_t
+  {
+    uint64_t pc;
+    uint64_t addr;
+    int64_t stride;
+    int confidence;
+  };
+
+  size_t line_shift;
+  size_t degree;
+  std::vector<entry_t> table;
+};
+
+// Jouppi's stream buffers: a miss that no buffer expects restarts the least
+// recently used one at the following lines, and a miss that hits a buffer's
+// head moves the line into the cache and fetches one more line
+class stream_prefetcher_t : public prefetcher_t
+{
+ public:
+  stream_prefetcher_t(size_t linesz, size_t buffers, size_t depth);
+  void access(uint64_t addr, uint64_t pc, bool trigger, uint64_t now,
+              std::vector<uint64_t>& fetch);
+  bool has_buffer() { return true; }
+  bool take(uint64_t line, uint64_t now, uint64_t& issued,
+            std::vector<uint64_t>& fetch);
+
+ private:
+  struct buffer_t
+  {
+    std::deque<std::pair<uint64_t, uint64_t>> lines; // line, time fetched
+    uint64_t next = 0;
+    uint64_t last_use = 0;
+  };
+
+  size_t line_shift;
+  size_t depth;
+  std::vector<buffer_t> buffers;
+  uint64_t last_taken; // so the access after a take doesn't restart a buffer
+};
+
+#endif
@@ -8,6 +8,7 @@
 #include "mmu.h"
 #include "disasm.h"
 #include "gdbserver.h"
+#include "timing.h"
 #include <cinttypes>
 #include <cmath>
 #include <cstdlib>
@@ -16,19 +17,26 @@
 #include <limits.h>
 #include <stdexcept>
 #include <algorithm>
+#include <mutex>
+#include <iterator>
+#include <cstring>
 
 #undef STATE
 #define STATE state
 
 processor_t::processor_t(const char* isa, sim_t* sim, uint32_t id,
         bool halt_on_reset)
-  : debug(false), sim(sim), ext(NULL), id(id), halt_on_reset(halt_on_reset)
+  : debug(false), sim(sim), ext(NULL), id(id), halt_on_reset(halt_on_reset),
+    insn_mix_enabled(false), profiler(NULL), branch_tracer(NULL),
+    trace_writer(NULL), timing(NULL)
 {
+  memset(hpm_events, 0, sizeof(hpm_events));
   parse_isa_string(isa);
   register_base_instructions();
 
   mmu = new mmu_t(sim, this);
   disassembler = new disassembler_t(max_xlen);
+  set_lockstep(false);
 
   reset();
 }
@@ -43,6 +51,10 @@ processor_t::~processor_t()
       fprintf(stderr, "%0" PRIx64 " %" PRIu64 "\n", it.first, it.second);
   }
 #endif
+#ifdef RISCV_ENABLE_INSN_MIX
+  if (insn_mix_enabled)
+    print_insn_mix();
+#endif
 
   delete mmu;
   delete disassembler;
@@ -54,7 +66,7 @@ static void bad_isa_string(const char* isa)
   abort();
 }
 
-void processor_t::parse_isa_string(const char* str)
+bool processor_t::parse_isa_string(const char* str, isa_desc_t* desc)
 {
   std::string lowercase, tmp;
   for (const char *r = str; *r; r++)
@@ -63,31 +75,31 @@ void processor_t::parse_isa_string(const char* str)
   const char* p = lowercase.c_str();
   const char* all_subsets = "imafdc";
 
-  max_xlen = 64;
-  isa = reg_t(2) << 62;
+  desc->max_xlen = 64;
+  desc->misa = reg_t(2) << 62;
+  desc->vector_subset = false;
+  desc->extensions.clear();
 
   if (strncmp(p, "rv32", 4) == 0)
-    max_xlen = 32, isa = reg_t(1) << 30, p += 4;
+    desc->max_xlen = 32, desc->misa = reg_t(1) << 30, p += 4;
   else if (strncmp(p, "rv64", 4) == 0)
     p += 4;
   else if (strncmp(p, "rv", 2) == 0)
     p += 2;
 
   if (!*p) {
-    p = all_subsets;
+    p = "imafdc";
   } else if (*p == 'g') { // treat "G" as "IMAFD"
     tmp = std::string("imafd") + (p+1);
     p = &tmp[0];
   } else if (*p != 'i') {
-    bad_isa_string(str);
+    return false;
   }
 
-  isa_string = "rv" + std::to_string(max_xlen) + p;
-  isa |= 1L << ('s' - 'a'); // advertise support for supervisor mode
-  isa |= 1L << ('u' - 'a'); // advertise support for user mode
+  desc->isa_string = "rv" + std::to_string(desc->max_xlen) + p;
 
   while (*p) {
-    isa |= 1L << (*p - 'a');
+    desc->misa |= 1L << (*p - 'a');
 
     if (auto next = strchr(all_subsets, *p)) {
       all_subsets = next + 1;
@@ -96,21 +108,38 @@ void processor_t::parse_isa_string(const char* str)
       const char* ext = p+1, *end = ext;
       while (islower(*end))
         end++;
-      register_extension(find_extension(std::string(ext, end - ext).c_str())());
+      std::string name(ext, end - ext);
+      if (name == "vsubset")
+        desc->vector_subset = true;
+      else
+        desc->extensions.push_back(name);
       p = end;
     } else {
-      bad_isa_string(str);
+      return false;
     }
   }
 
-  if (supports_extension('D') && !supports_extension('F'))
-    bad_isa_string(str);
+  if ((desc->misa & (1L << ('d' - 'a'))) && !(desc->misa & (1L << ('f' - 'a'))))
+    return false;
 
   // advertise support for supervisor and user modes
-  isa |= 1L << ('s' - 'a');
-  isa |= 1L << ('u' - 'a');
+  desc->misa |= 1L << ('s' - 'a');
+  desc->misa |= 1L << ('u' - 'a');
+  return true;
+}
+
+void processor_t::parse_isa_string(const char* str)
+{
+  isa_desc_t desc;
+  if (!parse_isa_string(str, &desc))
+    bad_isa_string(str);
 
-  max_isa = isa;
+  max_xlen = desc.max_xlen;
+  isa = max_isa = desc.misa;
+  isa_string = desc.isa_string;
+  vector_subset = desc.vector_subset;
+  for (auto& name : desc.extensions)
+    register_extension(find_extension(name.c_str())());
 }
 
 void state_t::reset()
@@ -137,9 +166,34 @@ void processor_t::set_debug(bool value)
 void processor_t::set_lockstep(bool value)
 {
   lockstep = value;
+  set_log_commits(true);
   mmu->set_lockstep(value);
 }
 
+void processor_t::set_log_commits(bool value)
+{
+  // lockstep always needs the commit state
+#ifdef RISCV_ENABLE_COMMITLOG
+  print_commits = value || lockstep;
+#else
+  print_commits = false;
+#endif
+  log_commits = print_commits || lockstep || trace_writer || commit_handler;
+  mmu->flush_icache();
+}
+
+void processor_t::set_trace_writer(trace_writer_t* t)
+{
+  trace_writer = t;
+  set_log_commits(print_commits);
+}
+
+void processor_t::set_commit_handler(commit_handler_t h)
+{
+  commit_handler = h;
+  set_log_commits(print_commits);
+}
+
 void processor_t::set_histogram(bool value)
 {
   histogram_enabled = value;
@@ -151,9 +205,110 @@ void processor_t::set_histogram(bool value)
 #endif
 }
 
+reg_t processor_t::get_mcycle()
+{
+  return timing ? timing->cycles(this) + cycle_bias : state.minstret;
+}
+
+void processor_t::set_timing_model(timing_model_t* t)
+{
+  // carry on from the current count
+  cycle_bias = t ? state.minstret - t->cycles(this) : 0;
+  timing = t;
+}
+
+void processor_t::set_state(const state_t& s, reg_t mcycle)
+{
+  state = s;
+  cycle_bias = timing ? mcycle - timing->cycles(this) : 0;
+}
+
+void processor_t::set_insn_mix(bool value)
+{
+  insn_mix_enabled = value;
+#ifndef RISCV_ENABLE_INSN_MIX
+  if (value) {
+    fprintf(stderr, "Instruction-mix support has not been properly enabled;");
+    fprintf(stderr, " please re-build the riscv-isa-run project using \"configure --enable-insn-mix\".\n");
+  }
+#endif
+}
+
+// instruction names by insn_desc_t::id, shared by every processor
+static std::vector<std::string> insn_names;
+static std::mutex insn_names_lock;
+
+static const char* insn_category(std::string name)
+{
+  static const char* system[] = {"ecall", "ebreak", "uret", "sret",
+    "mret", "dret", "wfi", "sfence_vm", "fence", "fence_i"};
+  static const char* branches[] = {"beq", "bne", "blt", "bge", "bltu", "bgeu",
+    "jal", "jalr", "j", "jr", "beqz", "bnez"};
+
+  if (name.compare(0, 2, "c_") == 0)
+    name = name.substr(2);
+  if (name.compare(0, 3, "amo") == 0 || name.compare(0, 3, "lr_") == 0 ||
+      name.compare(0, 3, "sc_") == 0)
+    return "amo";
+  if (name.compare(0, 3, "csr") == 0 ||
+      std::find(std::begin(system), std::end(system), name) != std::end(system))
+    return "csr";
+  if (std::find(std::begin(branches), std::end(branches), name) != std::end(branches))
+    return "branch";
+
+  // [f](l|s)(b|h|w|d)[u][sp]: loads and stores, including c.lwsp and the like
+  size_t i = name[0] == 'f';
+  if (name.size() >= i + 2 && (name[i] == 'l' || name[i] == 's') &&
+      strchr("bhwd", name[i+1]) && (name.size() == i + 2 ||
+      name.substr(i + 2) == "u" || name.substr(i + 2) == "sp"))
+    return "mem";
+  // v(l|s)(e|se|uxei|oxei)<eew>_v: vector loads and stores
+  if (name.size() > 4 && name[0] == 'v' && (name[1] == 'l' || name[1] == 's') &&
+      name.compare(name.size() - 2, 2, "_v") == 0) {
+    std::string mode = name.substr(2, name.find_first_of("0123456789") - 2);
+    if (mode == "e" || mode == "se" || mode == "uxei" || mode == "oxei")
+      return "mem";
+  }
+  if (name[0] == 'f' || name.compare(0, 2, "vf") == 0)
+    return "fp";
+  return "int";
+}
+
+void processor_t::print_insn_mix()
+{
+  std::vector<std::pair<uint64_t, size_t>> mix;
+  std::map<std::string, uint64_t> categories;
+  uint64_t total = 0;
+  for (size_t i = 0; i < insn_counts.size(); i++) {
+    if (insn_counts[i] == 0)
+      continue;
+    mix.push_back(std::make_pair(insn_counts[i], i));
+    categories[insn_category(insn_names[i])] += insn_counts[i];
+    total += insn_counts[i];
+  }
+  if (total == 0)
+    return;
+  std::sort(mix.rbegin(), mix.rend());
+
+  fprintf(stderr, "core %u instruction mix:\n", id);
+  for (auto& m : mix) {
+    std::string name = insn_names[m.second];
+    std::replace(name.begin(), name.end(), '_', '.');
+    fprintf(stderr, "  %-16s %14" PRIu64 " %7.3f%%\n", name.c_str(), m.first,
+            100.0 * m.first / total);
+  }
+  fprintf(stderr, "core %u instruction categories:\n", id);
+  for (auto& c : categories)
+    fprintf(stderr, "  %-16s %14" PRIu64 " %7.3f%%\n", c.first.c_str(), c.second,
+            100.0 * c.second / total);
+}
+
 void processor_t::reset()
 {
   state.reset();
+  state.vill = true;
+  state.vtype = reg_t(1) << (max_xlen - 1);
+  cycle_bias = timing ? -timing->cycles(this) : 0;
   state.dcsr.halt = halt_on_reset;
   halt_on_reset = false;
   set_csr(CSR_MSTATUS, state.mstatus);
@@ -177,7 +332,7 @@ static int ctz(reg_t val)
   return res;
 }
 
-void processor_t::take_interrupt()
+bool processor_t::take_interrupt()
 {
   reg_t pending_interrupts = state.mip & state.mie;
 
@@ -189,8 +344,11 @@ void processor_t::take_interrupt()
   reg_t s_enabled = state.prv < PRV_S || (state.prv == PRV_S && sie);
   enabled_interrupts |= pending_interrupts & state.mideleg & -s_enabled;
 
-  if (enabled_interrupts)
-    raise_interrupt(ctz(enabled_interrupts));
+  if (!enabled_interrupts)
+    return false;
+
+  state.pending_trap = ((reg_t)1 << (max_xlen-1)) | ctz(enabled_interrupts);
+  return true;
 }
 
 void processor_t::set_privilege(reg_t prv)
@@ -211,8 +369,26 @@ void processor_t::enter_debug_mode(uint8_t cause)
   state.pc = DEBUG_ROM_START;
 }
 
+void processor_t::count_trap(reg_t cause)
+{
+  reg_t interrupt = (reg_t)1 << (max_xlen-1);
+  reg_t code = cause & ~interrupt;
+  bool known = code < HPM_INTERRUPT_CAUSE - HPM_EXCEPTION_CAUSE;
+  if (cause & interrupt) {
+    count_event(HPM_INTERRUPT);
+    if (known)
+      count_event(hpm_event_t(HPM_INTERRUPT_CAUSE + code));
+  } else {
+    count_event(HPM_EXCEPTION);
+    if (known)
+      count_event(hpm_event_t(HPM_EXCEPTION_CAUSE + code));
+  }
+}
+
 void processor_t::take_trap(trap_t& t, reg_t epc)
 {
+  count_trap(t.cause());
+
   if (debug) {
     fprintf(stderr, "core %3d: exception %s, epc 0x%016" PRIx64 "\n",
             id, t.name(), epc);
@@ -272,6 +448,36 @@ void processor_t::take_trap(trap_t& t, reg_t epc)
   yield_load_reservation();
 }
 
+void processor_t::finish_trap(trap_t& t, reg_t epc)
+{
+  take_trap(t, epc);
+
+  if (unlikely(state.single_step == state.STEP_STEPPED)) {
+    state.single_step = state.STEP_NONE;
+    enter_debug_mode(DCSR_CAUSE_STEP);
+  }
+  if (lockstep) step(1);
+}
+
+void processor_t::finish_posted_trap(reg_t epc)
+{
+  switch (state.pending_trap) {
+    case CAUSE_MISALIGNED_LOAD:
+    case CAUSE_FAULT_LOAD:
+    case CAUSE_MISALIGNED_STORE:
+    case CAUSE_FAULT_STORE: {
+      mem_trap_t t(state.pending_trap, state.pending_badaddr);
+      finish_trap(t, epc);
+      break;
+    }
+    default: {
+      trap_t t(state.pending_trap);
+      finish_trap(t, epc);
+      break;
+    }
+  }
+}
+
 void processor_t::disasm(insn_t insn)
 {
   uint64_t bits = insn.bits() & ((1ULL << (8 * insn_length(insn.bits()))) - 1);
@@ -299,6 +505,32 @@ void processor_t::set_csr(int which, reg_t val)
   val = zext_xlen(val);
   reg_t delegable_ints = MIP_SSIP | MIP_STIP | MIP_SEIP; // | (1 << IRQ_COP);
   reg_t all_ints = delegable_ints | MIP_MSIP | MIP_MTIP | MIP_MEIP;
+
+  if (which >= CSR_MHPMCOUNTER3 && which <= CSR_MHPMCOUNTER31) {
+    int i = which - CSR_MHPMCOUNTER3;
+    if (xlen == 32)
+      val = (get_hpm_counter(i) >> 32 << 32) | (val & 0xffffffffU);
+    set_hpm_counter(i, val);
+    return;
+  }
+  if (xlen == 32 && which >= CSR_MHPMCOUNTER3H && which <= CSR_MHPMCOUNTER31H) {
+    int i = which - CSR_MHPMCOUNTER3H;
+    set_hpm_counter(i, (val << 32) | (get_hpm_counter(i) << 32 >> 32));
+    return;
+  }
+  if (which >= CSR_MHPMEVENT3 && which <= CSR_MHPMEVENT31) {
+    // switch events without disturbing the counter's current value
+    int i = which - CSR_MHPMEVENT3;
+    reg_t count = get_hpm_counter(i);
+    // mhpmevent is WARL: any other number selects no event, and reads 0
+    bool defined = val < HPM_NUM_BASIC_EVENTS ||
+      (val >= HPM_EXCEPTION_CAUSE && val <= HPM_EXCEPTION_CAUSE + CAUSE_MACHINE_ECALL) ||
+      (val >= HPM_INTERRUPT_CAUSE && val <= HPM_INTERRUPT_CAUSE + IRQ_HOST);
+    state.mhpmevent[i] = defined ? val : HPM_NONE;
+    set_hpm_counter(i, count);
+    return;
+  }
+
   switch (which)
   {
     case CSR_FFLAGS:
@@ -314,6 +546,27 @@ void processor_t::set_csr(int which, reg_t val)
       state.fflags = (val & FSR_AEXC) >> FSR_AEXC_SHIFT;
       state.frm = (val & FSR_RD) >> FSR_RD_SHIFT;
       break;
+    case CSR_VSTART:
+      if (!supports_vector())
+        break;
+      state.vstart = val & (VLEN - 1);
+      break;
+    case CSR_VXSAT:
+      if (!supports_vector())
+        break;
+      state.vxsat = val & 1;
+      break;
+    case CSR_VXRM:
+      if (!supports_vector())
+        break;
+      state.vxrm = val & 3;
+      break;
+    case CSR_VCSR:
+      if (!supports_vector())
+        break;
+      state.vxsat = val & 1;
+      state.vxrm = (val >> 1) & 3;
+      break;
     case CSR_MSTATUS: {
       if ((val ^ state.mstatus) &
           (MSTATUS_VM | MSTATUS_MPP | MSTATUS_MPRV | MSTATUS_PUM | MSTATUS_MXR))
@@ -365,16 +618,29 @@ void processor_t::set_csr(int which, reg_t val)
       break;
     }
     case CSR_MINSTRET:
-    case CSR_MCYCLE:
       if (xlen == 32)
         state.minstret = (state.minstret >> 32 << 32) | (val & 0xffffffffU);
       else
         state.minstret = val;
       break;
     case CSR_MINSTRETH:
-    case CSR_MCYCLEH:
       state.minstret = (val << 32) | (state.minstret << 32 >> 32);
       break;
+    case CSR_MCYCLE:
+    case CSR_MCYCLEH: {
+      // without a timing model, mcycle is minstret
+      if (!timing)
+        return set_csr(which == CSR_MCYCLE ? CSR_MINSTRET : CSR_MINSTRETH, val);
+      reg_t cycle = get_mcycle();
+      if (which == CSR_MCYCLEH)
+        cycle = (val << 32) | (cycle << 32 >> 32);
+      else if (xlen == 32)
+        cycle = (cycle >> 32 << 32) | (val & 0xffffffffU);
+      else
+        cycle = val;
+      cycle_bias += cycle - get_mcycle();
+      break;
+    }
     case CSR_MUCOUNTEREN:
       state.mucounteren = val;
       break;
@@ -480,6 +746,18 @@ void processor_t::set_csr(int which, reg_t val)
   }
 }
 
+// the counters run continuously; each mhpmcounter is the count of its
+// selected event relative to the count when the counter was last written
+reg_t processor_t::get_hpm_counter(int i)
+{
+  return hpm_events[state.mhpmevent[i]] - state.mhpmcounter_base[i];
+}
+
+void processor_t::set_hpm_counter(int i, reg_t val)
+{
+  state.mhpmcounter_base[i] = hpm_events[state.mhpmevent[i]] - val;
+}
+
 reg_t processor_t::get_csr(int which)
 {
   reg_t ctr_en = state.prv == PRV_U ? state.mucounteren :
@@ -488,47 +766,79 @@ reg_t processor_t::get_csr(int which)
 
   if (ctr_ok) {
     if (which >= CSR_HPMCOUNTER3 && which <= CSR_HPMCOUNTER31)
-      return 0;
+      return get_hpm_counter(which - CSR_HPMCOUNTER3);
     if (xlen == 32 && which >= CSR_HPMCOUNTER3H && which <= CSR_HPMCOUNTER31H)
-      return 0;
+      return get_hpm_counter(which - CSR_HPMCOUNTER3H) >> 32;
   }
   if (which >= CSR_MHPMCOUNTER3 && which <= CSR_MHPMCOUNTER31)
-    return 0;
-  if (xlen == 32 && which >= CSR_MHPMCOUNTER3 && which <= CSR_MHPMCOUNTER31)
-    return 0;
+    return get_hpm_counter(which - CSR_MHPMCOUNTER3);
+  if (xlen == 32 && which >= CSR_MHPMCOUNTER3H && which <= CSR_MHPMCOUNTER31H)
+    return get_hpm_counter(which - CSR_MHPMCOUNTER3H) >> 32;
   if (which >= CSR_MHPMEVENT3 && which <= CSR_MHPMEVENT31)
-    return 0;
+    return state.mhpmevent[which - CSR_MHPMEVENT3];
 
   switch (which)
   {
     case CSR_FFLAGS:
-      require_fp;
-      if (!supports_extension('F'))
+      if (!supports_extension('F') || !(state.mstatus & MSTATUS_FS))
         break;
       return state.fflags;
     case CSR_FRM:
-      require_fp;
-      if (!supports_extension('F'))
+      if (!supports_extension('F') || !(state.mstatus & MSTATUS_FS))
         break;
       return state.frm;
     case CSR_FCSR:
-      require_fp;
-      if (!supports_extension('F'))
+      if (!supports_extension('F') || !(state.mstatus & MSTATUS_FS))
         break;
       return (state.fflags << FSR_AEXC_SHIFT) | (state.frm << FSR_RD_SHIFT);
+    case CSR_VSTART:
+      if (!supports_vector())
+        break;
+      return state.vstart;
+    case CSR_VXSAT:
+      if (!supports_vector())
+        break;
+      return state.vxsat;
+    case CSR_VXRM:
+      if (!supports_vector())
+        break;
+      return state.vxrm;
+    case CSR_VCSR:
+      if (!supports_vector())
+        break;
+      return (state.vxrm << 1) | state.vxsat;
+    case CSR_VL:
+      if (!supports_vector())
+        break;
+      return state.vl;
+    case CSR_VTYPE:
+      if (!supports_vector())
+        break;
+      return state.vtype;
+    case CSR_VLENB:
+      if (!supports_vector())
+        break;
+      return VLENB;
     case CSR_INSTRET:
-    case CSR_CYCLE:
       if (ctr_ok)
         return state.minstret;
       break;
+    case CSR_CYCLE:
+      if (ctr_ok)
+        return get_mcycle();
+      break;
     case CSR_MINSTRET:
-    case CSR_MCYCLE:
       return state.minstret;
+    case CSR_MCYCLE:
+      return get_mcycle();
     case CSR_MINSTRETH:
-    case CSR_MCYCLEH:
       if (xlen == 32)
         return state.minstret >> 32;
       break;
+    case CSR_MCYCLEH:
+      if (xlen == 32)
+        return get_mcycle() >> 32;
+      break;
     case CSR_MUCOUNTEREN: return state.mucounteren;
     case CSR_MSCOUNTEREN: return state.mscounteren;
     case CSR_SSTATUS: {
@@ -628,7 +938,16 @@ reg_t processor_t::get_csr(int which)
 
 reg_t illegal_instruction(processor_t* p, insn_t insn, reg_t pc)
 {
-  throw trap_illegal_instruction();
+  p->get_state()->pending_trap = CAUSE_ILLEGAL_INSTRUCTION;
+  return PC_TRAP;
+}
+
+reg_t processor_t::roi_hint(processor_t* p, insn_t insn, reg_t pc)
+{
+  p->sim->roi(p, insn.i_imm() - ROI_HINT_BASE);
+  // the hint may change how the following instructions should be run
+  p->state.pc = pc + 4;
+  return PC_SERIALIZE_AFTER;
 }
 
 insn_func_t processor_t::decode_insn(insn_t insn)
@@ -657,11 +976,26 @@ insn_func_t processor_t::decode_insn(insn_t insn)
     opcode_cache[idx].match = insn.bits();
   }
 
+  if (log_commits)
+    return xlen == 64 ? desc.logged_rv64 : desc.logged_rv32;
   return xlen == 64 ? desc.rv64 : desc.rv32;
 }
 
 void processor_t::register_insn(insn_desc_t desc)
 {
+  if (!desc.logged_rv32)
+    desc.logged_rv32 = desc.rv32;
+  if (!desc.logged_rv64)
+    desc.logged_rv64 = desc.rv64;
+  if (desc.id) {
+    std::lock_guard<std::mutex> lock(insn_names_lock);
+    if (*desc.id == size_t(-1)) {
+      *desc.id = insn_names.size();
+      insn_names.push_back(desc.name);
+    }
+    if (insn_counts.size() <= *desc.id)
+      insn_counts.resize(*desc.id + 1);
+  }
   instructions.push_back(desc);
 }
 
@@ -677,7 +1011,8 @@ void processor_t::build_opcode_map()
   std::sort(instructions.begin(), instructions.end(), cmp());
 
   for (size_t i = 0; i < OPCODE_CACHE_SIZE; i++)
-    opcode_cache[i] = {0, 0, &illegal_instruction, &illegal_instruction};
+    opcode_cache[i] = {0, 0, &illegal_instruction, &illegal_instruction,
+                       &illegal_instruction, &illegal_instruction};
 }
 
 void processor_t::register_extension(extension_t* x)
@@ -695,17 +1030,30 @@ void processor_t::register_extension(extension_t* x)
 
 void processor_t::register_base_instructions()
 {
-  #define DECLARE_INSN(name, match, mask) \
-    insn_bits_t name##_match = (match), name##_mask = (mask);
-  #include "encoding.h"
-  #undef DECLARE_INSN
-
-  #define DEFINE_INSN(name) \
-    REGISTER_INSN(this, name, name##_match, name##_mask)
-  #include "insn_list.h"
-  #undef DEFINE_INSN
-
-  register_insn({0, 0, &illegal_instruction, &illegal_instruction});
+  // the first processor registers and sorts the base instructions; the
+  // rest, in this or any other thread, start from a copy of its list
+  static const std::vector<insn_desc_t> base = [this]() {
+    #define DECLARE_INSN(name, match, mask) \
+      insn_bits_t name##_match = (match), name##_mask = (mask);
+    #include "encoding.h"
+    #undef DECLARE_INSN
+
+    #define DEFINE_INSN(name) \
+      REGISTER_INSN(this, name, name##_match, name##_mask)
+    #include "insn_list.h"
+    #undef DEFINE_INSN
+
+    register_insn({MATCH_ROI_HINT, MASK_ROI_HINT, &roi_hint, &roi_hint});
+    register_insn({0, 0, &illegal_instruction, &illegal_instruction});
+    build_opcode_map();
+    return instructions;
+  }();
+
+  if (instructions.empty()) {
+    instructions = base;
+    std::lock_guard<std::mutex> lock(insn_names_lock);
+    insn_counts.resize(insn_names.size());
+  }
   build_opcode_map();
 }
 
@@ -732,6 +1080,7 @@ bool processor_t::store(reg_t addr, size_t len, const uint8_t* bytes)
 void processor_t::trigger_updated()
 {
   mmu->flush_tlb();
+  mmu->flush_icache();
   mmu->check_triggers_fetch = false;
   mmu->check_triggers_load = false;
   mmu->check_triggers_store = false;
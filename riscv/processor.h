@@ -8,6 +8,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <functional>
 
 class processor_t;
 class mmu_t;
@@ -16,6 +17,10 @@ class sim_t;
 class trap_t;
 class extension_t;
 class disassembler_t;
+class profiler_t;
+class branch_tracer_t;
+class timing_model_t;
+class trace_writer_t;
 
 struct insn_desc_t
 {
@@ -23,8 +28,58 @@ struct insn_desc_t
   insn_bits_t mask;
   insn_func_t rv32;
   insn_func_t rv64;
+  insn_func_t logged_rv32; // variants that record commit-log state;
+  insn_func_t logged_rv64; // default to rv32/rv64 when left null
+  const char* name;
+  size_t* id; // set to a dense index for the instruction-mix counters
 };
 
+// events that mhpmcounter3..31 can count, as selected by mhpmevent3..31
+enum hpm_event_t
+{
+  HPM_NONE,
+  HPM_LOAD,
+  HPM_STORE,
+  HPM_AMO,
+  HPM_BRANCH,
+  HPM_ITLB_REFILL,
+  HPM_DTLB_REFILL,
+  HPM_PAGE_WALK,
+  HPM_ICACHE_REFILL,
+  HPM_EXCEPTION,
+  HPM_INTERRUPT,
+  HPM_INSTRET,
+  HPM_MMIO_ACCESS,
+  HPM_SLOW_PATH, // loads, stores and fetches that missed the TLB fast path
+  HPM_MUL,
+  HPM_DIV,
+  HPM_FP,
+  HPM_FDIV, // and square roots
+  HPM_NUM_BASIC_EVENTS,
+  HPM_EXCEPTION_CAUSE = 0x40, // + exception cause
+  HPM_INTERRUPT_CAUSE = 0x80, // + interrupt cause
+  HPM_NUM_EVENTS = 0xc0
+};
+
+// Region-of-interest hints.  "slti x0, x0, ROI_HINT_BASE + <op>" writes x0,
+// so it is a HINT that real hardware ignores; guest code can execute it
+// around the code of interest to control the simulator.  Only immediates
+// in that range of 16 are taken over; other slti x0 hints run as before.
+#define ROI_HINT_BASE 0x7f0
+enum roi_op_t
+{
+  ROI_STATS_START = 1, // count statistics from here on
+  ROI_STATS_STOP,      // freeze statistics
+  ROI_TRACE_ON,        // attach the memtracers (--ic, --dc, --l2, --trace)
+  ROI_TRACE_OFF,       // detach them
+  ROI_LOG_ON,          // log instructions and commits, if -l asked for it
+  ROI_LOG_OFF,
+  ROI_STATS_DUMP,      // write statistics as with SIGUSR1
+  ROI_CHECKPOINT,      // call the checkpoint handler, if any
+};
+#define MATCH_ROI_HINT (MATCH_SLTI | (ROI_HINT_BASE << 20))
+#define MASK_ROI_HINT (MASK_SLTI | 0xff0f8f80) /* rd = rs1 = x0 */
+
 struct commit_log_reg_t
 {
   reg_t addr;
@@ -107,6 +162,9 @@ struct state_t
   reg_t mideleg;
   uint32_t mucounteren;
   uint32_t mscounteren;
+  static const int num_hpm_counters = 29; // mhpmcounter3..31
+  reg_t mhpmevent[num_hpm_counters];
+  reg_t mhpmcounter_base[num_hpm_counters]; // event count when it read 0
   reg_t sepc;
   reg_t sbadaddr;
   reg_t sscratch;
@@ -122,6 +180,20 @@ struct state_t
 
   uint32_t fflags;
   uint32_t frm;
+
+  // the vector unit.  vtype is kept decoded, too: vsew is the element
+  // width in bytes and vlmul the log2 of LMUL, -3 to 3.  The registers are
+  // contiguous, so a register group is a contiguous run of bytes.
+  reg_t vl;
+  reg_t vtype;
+  reg_t vstart;
+  reg_t vlmax;
+  reg_t vsew;
+  int vlmul;
+  bool vill;
+  uint32_t vxrm;
+  uint32_t vxsat;
+  alignas(VLENB) uint8_t VR[NVPR * VLENB];
   bool serialized; // whether timer CSRs are in a well-defined state
 
   // When true, execute a single instruction and then enter debug mode.  This
@@ -133,6 +205,8 @@ struct state_t
   } single_step;
 
   reg_t load_reservation;
+  reg_t pending_trap; // cause posted by a handler that returned PC_TRAP
+  reg_t pending_badaddr; // and the address, if an access faulted
 
 // #ifdef RISCV_ENABLE_COMMITLOG
   commit_log_reg_t log_reg_write;
@@ -162,15 +236,32 @@ static int cto(reg_t val)
 }
 
 // this class represents one processor in a RISC-V machine.
+// what an ISA string such as "RV64IMAFDCXVSUBSET" asks for
+struct isa_desc_t
+{
+  unsigned max_xlen;
+  reg_t misa;
+  std::string isa_string; // lowercase, with G expanded
+  bool vector_subset;
+  std::vector<std::string> extensions; // named X<name>, other than xvsubset
+};
+
 class processor_t : public abstract_device_t
 {
 public:
   processor_t(const char* isa, sim_t* sim, uint32_t id, bool halt_on_reset=false);
   ~processor_t();
 
+  // false if isa isn't an ISA string spike can model.  The constructor
+  // aborts on those, so callers that can recover check first.
+  static bool parse_isa_string(const char* isa, isa_desc_t* desc);
+
   void set_debug(bool value);
   void set_lockstep(bool value);
+  // print commits as they retire; only builds with --enable-commitlog can
+  void set_log_commits(bool value);
   void set_histogram(bool value);
+  void set_insn_mix(bool value);
   void reset();
   void step(size_t n); // run for n cycles
   void set_csr(int which, reg_t val);
@@ -178,14 +269,39 @@ public:
   reg_t get_csr(int which);
   mmu_t* get_mmu() { return mmu; }
   state_t* get_state() { return &state; }
+  // go back to a state copied from get_state() when mcycle read mcycle
+  void set_state(const state_t& s, reg_t mcycle);
   extension_t* get_extension() { return ext; }
   bool supports_extension(unsigned char ext) {
     if (ext >= 'a' && ext <= 'z') ext += 'A' - 'a';
     return ext >= 'A' && ext <= 'Z' && ((isa >> (ext - 'A')) & 1);
   }
+  // the vector instructions are a subset of V, so they're enabled by the
+  // non-standard "xvsubset" in the ISA string and don't set misa.V
+  bool supports_vector() { return vector_subset; }
   void set_privilege(reg_t);
   void yield_load_reservation() { state.load_reservation = (reg_t)-1; }
   void update_histogram(reg_t pc);
+  void count_insn(size_t id) { insn_counts[id]++; }
+  void count_event(hpm_event_t event, uint64_t n = 1) { hpm_events[event] += n; }
+  uint64_t get_event_count(hpm_event_t event) { return hpm_events[event]; }
+  void set_event_count(hpm_event_t event, uint64_t n) { hpm_events[event] = n; }
+  uint32_t get_id() { return id; }
+  profiler_t* get_profiler() { return profiler; }
+  void set_profiler(profiler_t* p) { profiler = p; }
+  branch_tracer_t* get_branch_tracer() { return branch_tracer; }
+  void set_branch_tracer(branch_tracer_t* t) { branch_tracer = t; }
+  trace_writer_t* get_trace_writer() { return trace_writer; }
+  void set_trace_writer(trace_writer_t* t);
+  // called for each instruction the hart retires, with the register it
+  // wrote (addr 0 if none) as in commit logs
+  typedef std::function<void(processor_t*, reg_t pc, insn_t insn, const commit_log_reg_t&)> commit_handler_t;
+  const commit_handler_t& get_commit_handler() { return commit_handler; }
+  void set_commit_handler(commit_handler_t h);
+  bool get_print_commits() { return print_commits; }
+  // mcycle counts the model's cycles instead of following minstret
+  void set_timing_model(timing_model_t* t);
+  reg_t get_mcycle();
   const disassembler_t* get_disassembler() { return disassembler; }
 
   void register_insn(insn_desc_t);
@@ -295,19 +411,42 @@ private:
   reg_t isa;
   reg_t max_isa;
   std::string isa_string;
+  bool vector_subset;
   bool lockstep;
+  bool log_commits; // decode to the commit-logging instruction variants
+  bool print_commits; // and print them (-l with --enable-commitlog)
   bool histogram_enabled;
   bool halt_on_reset;
 
   std::vector<insn_desc_t> instructions;
   std::map<reg_t,uint64_t> pc_histogram;
+  bool insn_mix_enabled;
+  std::vector<uint64_t> insn_counts; // by insn_desc_t::id
+  void print_insn_mix();
+  uint64_t hpm_events[HPM_NUM_EVENTS];
+  profiler_t* profiler;
+  branch_tracer_t* branch_tracer;
+  trace_writer_t* trace_writer;
+  commit_handler_t commit_handler;
+  timing_model_t* timing;
+  reg_t cycle_bias; // mcycle minus the model's count
 
   static const size_t OPCODE_CACHE_SIZE = 8191;
   insn_desc_t opcode_cache[OPCODE_CACHE_SIZE];
 
+  enum step_mode_t { STEP_FAST, STEP_SLOW, STEP_LOCKSTEP };
+  template<step_mode_t mode, bool logged>
+  void execute_batch(size_t& n);
+
+  reg_t get_hpm_counter(int i);
+  void set_hpm_counter(int i, reg_t val);
+  void count_trap(reg_t cause);
+
   void check_timer();
-  void take_interrupt(); // take a trap if any interrupts are pending
+  bool take_interrupt(); // post a trap if any interrupts are pending
   void take_trap(trap_t& t, reg_t epc); // take an exception
+  void finish_trap(trap_t& t, reg_t epc); // take a trap that ends step()
+  void finish_posted_trap(reg_t epc); // the same for state.pending_trap
   void disasm(insn_t insn); // disassemble and print an instruction
   int paddr_bits();
 
@@ -322,6 +461,7 @@ private:
   void build_opcode_map();
   void register_base_instructions();
   insn_func_t decode_insn(insn_t insn);
+  static reg_t roi_hint(processor_t* p, insn_t insn, reg_t pc);
 };
 
 reg_t illegal_instruction(processor_t* p, insn_t insn, reg_t pc);
@@ -329,6 +469,11 @@ reg_t illegal_instruction(processor_t* p, insn_t insn, reg_t pc);
 #define REGISTER_INSN(proc, name, match, mask) \
   extern reg_t rv32_##name(processor_t*, insn_t, reg_t); \
   extern reg_t rv64_##name(processor_t*, insn_t, reg_t); \
-  proc->register_insn((insn_desc_t){match, mask, rv32_##name, rv64_##name});
+  extern reg_t rv32_logged_##name(processor_t*, insn_t, reg_t); \
+  extern reg_t rv64_logged_##name(processor_t*, insn_t, reg_t); \
+  extern size_t insn_id_##name; \
+  proc->register_insn((insn_desc_t){match, mask, rv32_##name, rv64_##name, \
+                                    rv32_logged_##name, rv64_logged_##name, \
+                                    #name, &insn_id_##name});
 
 #endif
@@ -0,0 +1,166 @@
+// See LICENSE for license details.
+
+#include "profiler.h"
+#include "processor.h"
+#include <elf.h>
+#include <string.h>
+#include <cinttypes>
+#include <fstream>
+#include <iterator>
+
+profiler_t::profiler_t(size_t nprocs)
+  : harts(nprocs)
+{
+  for (auto& h : harts)
+    h.last_instret = 0;
+}
+
+template<class Ehdr, class Shdr, class Sym>
+void profiler_t::load_symbols(const std::vector<char>& buf)
+{
+  auto eh = (const Ehdr*)&buf[0];
+  if (eh->e_shoff + (size_t)eh->e_shnum * sizeof(Shdr) > buf.size())
+    return;
+  auto sh = (const Shdr*)&buf[eh->e_shoff];
+
+  for (unsigned i = 0; i < eh->e_shnum; i++) {
+    if (sh[i].sh_type != SHT_SYMTAB || sh[i].sh_link >= eh->e_shnum)
+      continue;
+    const Shdr& strtab = sh[sh[i].sh_link];
+    if (sh[i].sh_offset + sh[i].sh_size > buf.size() ||
+        strtab.sh_offset + strtab.sh_size > buf.size())
+      continue;
+
+    auto sym = (const Sym*)&buf[sh[i].sh_offset];
+    for (size_t j = 0; j < sh[i].sh_size / sizeof(Sym); j++) {
+      if ((sym[j].st_info & 0xf) != STT_FUNC || !sym[j].st_value ||
+          sym[j].st_name >= strtab.sh_size)
+        continue;
+      const char* name = &buf[strtab.sh_offset + sym[j].st_name];
+      symbols[sym[j].st_value] = {
+        std::string(name, strnlen(name, strtab.sh_size - sym[j].st_name)),
+        (reg_t)sym[j].st_size};
+    }
+  }
+}
+
+bool profiler_t::add_symbols(const char* fn)
+{
+  std::ifstream in(fn, std::ios::binary);
+  std::vector<char> buf((std::istreambuf_iterator<char>(in)),
+                        std::istreambuf_iterator<char>());
+  if (buf.size() < sizeof(Elf64_Ehdr) || memcmp(&buf[0], ELFMAG, SELFMAG) != 0)
+    return false;
+
+  if (buf[EI_CLASS] == ELFCLASS32)
+    load_symbols<Elf32_Ehdr, Elf32_Shdr, Elf32_Sym>(buf);
+  else if (buf[EI_CLASS] == ELFCLASS64)
+    load_symbols<Elf64_Ehdr, Elf64_Shdr, Elf64_Sym>(buf);
+  else
+    return false;
+  return true;
+}
+
+static bool is_link_reg(reg_t r)
+{
+  return r == 1 || r == 5;
+}
+
+void profiler_t::jump(processor_t* p, insn_bits_t opc, insn_t insn, reg_t pc, reg_t npc)
+{
+  reg_t rd, rs1;
+  if ((opc & 3) == 3) {
+    rd = insn.rd();
+    rs1 = (opc & 0x7f) == MATCH_JALR ? insn.rs1() : 0;
+  } else if (opc == MATCH_C_JAL) {
+    if (npc == pc + 2)
+      return; // c.addiw shares the encoding on RV64
+    rd = 1;
+    rs1 = 0;
+  } else {
+    if (insn.rvc_rs2() != 0)
+      return; // c.mv or c.add
+    rd = opc == MATCH_C_JALR ? 1 : 0;
+    rs1 = insn.rvc_rs1();
+  }
+
+  // the return-address stack hints from the RISC-V ISA manual
+  auto& stack = harts[p->get_id()].stacks[p->get_state()->prv & 3];
+  if (is_link_reg(rs1) && rs1 != rd)
+    ret(stack, npc);
+  if (is_link_reg(rd))
+    call(stack, npc, pc + insn_length(opc));
+}
+
+void profiler_t::call(std::vector<frame_t>& stack, reg_t target, reg_t return_addr)
+{
+  if (stack.size() < MAX_DEPTH)
+    stack.push_back({target, return_addr});
+}
+
+void profiler_t::ret(std::vector<frame_t>& stack, reg_t target)
+{
+  // pop through frames skipped by longjmp and the like; if nothing matches,
+  // the stack was lost (e.g. to a context switch), so start over
+  for (size_t i = stack.size(); i > 0; i--) {
+    if (stack[i-1].return_addr == target) {
+      stack.resize(i-1);
+      return;
+    }
+  }
+  stack.clear();
+}
+
+void profiler_t::sample(processor_t* p)
+{
+  hart_t& h = harts[p->get_id()];
+  uint64_t instret = p->get_event_count(HPM_INSTRET);
+  if (instret == h.last_instret)
+    return;
+
+  reg_t prv = p->get_state()->prv & 3;
+  std::vector<reg_t> key(1, prv);
+  for (auto& f : h.stacks[prv])
+    key.push_back(f.func);
+  key.push_back(p->get_state()->pc);
+
+  samples[key] += instret - h.last_instret;
+  h.last_instret = instret;
+}
+
+std::string profiler_t::symbolize(reg_t addr)
+{
+  auto it = symbols.upper_bound(addr);
+  if (it != symbols.begin()) {
+    --it;
+    if (!it->second.size || addr < it->first + it->second.size)
+      return it->second.name;
+  }
+
+  char buf[32];
+  snprintf(buf, sizeof buf, "0x%" PRIx64, addr);
+  return buf;
+}
+
+void profiler_t::write(FILE* out)
+{
+  static const char* modes[] = {"U", "S", "H", "M"};
+
+  std::map<std::string, uint64_t> stacks;
+  for (auto& s : samples) {
+    const std::vector<reg_t>& key = s.first;
+    std::string stack = modes[key[0]], last;
+    for (size_t i = 1; i < key.size(); i++) {
+      std::string name = symbolize(key[i]);
+      // the sampled pc usually lies in the innermost called function
+      if (i == key.size() - 1 && name == last)
+        break;
+      stack += ";" + name;
+      last = name;
+    }
+    stacks[stack] += s.second;
+  }
+
+  for (auto& s : stacks)
+    fprintf(out, "%s %" PRIu64 "\n", s.first.c_str(), s.second);
+}
@@ -0,0 +1,63 @@
+// See LICENSE for license details.
+
+#ifndef _RISCV_PROFILER_H
+#define _RISCV_PROFILER_H
+
+#include "decode.h"
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class processor_t;
+
+// A guest profiler.  It follows calls and returns through the standard
+// link registers (x1 and x5) to keep a shadow call stack per hart and
+// privilege mode, samples those stacks whenever a processor finishes a
+// quantum, and writes them out as collapsed stacks for flame graphs.
+class profiler_t
+{
+ public:
+  profiler_t(size_t nprocs);
+
+  // load function symbols from an ELF file; false if it isn't one
+  bool add_symbols(const char* fn);
+
+  // a jump that may link or return (see trace_opcode)
+  void jump(processor_t* p, insn_bits_t opc, insn_t insn, reg_t pc, reg_t npc);
+  // charge the instructions retired since the last sample to the current stack
+  void sample(processor_t* p);
+
+  // one line per distinct stack: "mode;caller;...;callee count"
+  void write(FILE* out);
+
+ private:
+  struct frame_t
+  {
+    reg_t func;
+    reg_t return_addr;
+  };
+  struct hart_t
+  {
+    std::vector<frame_t> stacks[4]; // indexed by privilege mode
+    uint64_t last_instret;
+  };
+  struct symbol_t
+  {
+    std::string name;
+    reg_t size;
+  };
+
+  static const size_t MAX_DEPTH = 256;
+  std::vector<hart_t> harts;
+  std::map<std::vector<reg_t>, uint64_t> samples; // (mode, funcs..., pc)
+  std::map<reg_t, symbol_t> symbols;
+
+  template<class Ehdr, class Shdr, class Sym>
+  void load_symbols(const std::vector<char>& buf);
+  void call(std::vector<frame_t>& stack, reg_t target, reg_t return_addr);
+  void ret(std::vector<frame_t>& stack, reg_t target);
+  std::string symbolize(reg_t addr);
+};
+
+#endif
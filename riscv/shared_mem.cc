@@ -0,0 +1,94 @@
+// See LICENSE for license details.
+
+#include "shared_mem.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int shared_mem_open(const char* name, int flags)
+{
+  if (strncmp(name, "shm:", 4) == 0) {
+    std::string shm = name + 4;
+    if (shm[0] != '/')
+      shm = "/" + shm;
+    return shm_open(shm.c_str(), flags, 0666);
+  }
+  return open(name, flags, 0666);
+}
+
+store_ring_t::store_ring_t(const char* name, size_t entries)
+{
+  static_assert(sizeof(store_ring_header_t) <= STORE_RING_OFFSET, "ring header too big");
+
+  int fd = shared_mem_open(name, O_RDWR | O_CREAT);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    fprintf(stderr, "could not open %s\n", name);
+    exit(1);
+  }
+
+  bool created = st.st_size == 0;
+  if (!created) {
+    char magic[8];
+    uint64_t n;
+    if (pread(fd, magic, 8, 0) != 8 || memcmp(magic, STORE_RING_MAGIC, 8) != 0 ||
+        pread(fd, &n, 8, 8) != 8) {
+      fprintf(stderr, "%s is not a store ring\n", name);
+      exit(1);
+    }
+    entries = n;
+  }
+  if (entries == 0 || (entries & (entries-1))) {
+    fprintf(stderr, "%s: ring entries must be a power of 2\n", name);
+    exit(1);
+  }
+
+  map_size = STORE_RING_OFFSET + entries * sizeof(store_ring_entry_t);
+  if ((created || (size_t)st.st_size < map_size) && ftruncate(fd, map_size) < 0) {
+    fprintf(stderr, "could not size %s\n", name);
+    exit(1);
+  }
+  void* p = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    fprintf(stderr, "could not map %s\n", name);
+    exit(1);
+  }
+
+  header = (store_ring_header_t*)p;
+  ring = (store_ring_entry_t*)((char*)p + STORE_RING_OFFSET);
+  mask = entries - 1;
+  if (created) {
+    header->entries = entries;
+    header->head = 0;
+    header->tail = 0;
+    // the magic goes last, so a consumer that sees it sees the rest
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header->magic, STORE_RING_MAGIC, sizeof(header->magic));
+  }
+  head = header->head.load(std::memory_order_relaxed);
+}
+
+store_ring_t::~store_ring_t()
+{
+  munmap(header, map_size);
+}
+
+void store_ring_t::post(uint64_t addr, size_t bytes, uint64_t pc)
+{
+  while (head - header->tail.load(std::memory_order_acquire) > mask)
+    std::this_thread::yield();
+
+  store_ring_entry_t& e = ring[head & mask];
+  e.addr = addr;
+  e.pc = pc;
+  e.bytes = bytes;
+  e.reserved = 0;
+  header->head.store(++head, std::memory_order_release);
+}
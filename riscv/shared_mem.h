@@ -0,0 +1,80 @@
+// See LICENSE for license details.
+
+#ifndef _RISCV_SHARED_MEM_H
+#define _RISCV_SHARED_MEM_H
+
+// Target memory shared with another process, such as an RTL simulator
+// running in lockstep (see sim_t::map_mem), and a ring through which that
+// process learns of the target's stores.
+
+#include "memtracer.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// open a file, or the POSIX shared memory object <name> if the name is
+// "shm:<name>", with open(2) flags; -1 on failure, with errno set
+int shared_mem_open(const char* name, int flags);
+
+#define STORE_RING_MAGIC "SPKRING"
+#define STORE_RING_OFFSET 128 // of the first entry
+
+// The ring is a file or shared memory object holding a header and a
+// power-of-two number of entries.  spike is the only producer: it fills
+// entry head % entries and then advances head.  The consumer reads entries
+// up to head and advances tail past them; spike waits when the ring is
+// full.  The data stored is in the shared memory itself.
+struct store_ring_header_t
+{
+  char magic[8];                 // STORE_RING_MAGIC
+  uint64_t entries;
+  std::atomic<uint64_t> head;    // written by spike
+  char pad[40];                  // keep head and tail on separate lines
+  std::atomic<uint64_t> tail;    // written by the consumer
+};
+
+struct store_ring_entry_t
+{
+  uint64_t addr;  // physical address
+  uint64_t pc;    // the storing instruction, or 0 for a debugger or host store
+  uint32_t bytes;
+  uint32_t reserved;
+};
+
+// Posts every store to memory to a ring.  A ring that doesn't exist yet is
+// created with the given number of entries; an existing one is used as is.
+// It is an access tracer (see mmu_t::register_access_tracer), so stores
+// stay on the TLB, and it ignores the loads it is also handed.
+class store_ring_t : public memtracer_t
+{
+ public:
+  static const size_t DEFAULT_ENTRIES = 1 << 16;
+
+  store_ring_t(const char* name, size_t entries = DEFAULT_ENTRIES);
+  ~store_ring_t();
+
+  bool interested_in_range(uint64_t begin, uint64_t end, access_type type)
+  {
+    return type == STORE;
+  }
+  void trace(uint64_t addr, size_t bytes, access_type type)
+  {
+    trace_pc(addr, bytes, type, 0);
+  }
+  void trace_pc(uint64_t addr, size_t bytes, access_type type, uint64_t pc)
+  {
+    if (type == STORE)
+      post(addr, bytes, pc);
+  }
+
+ private:
+  void post(uint64_t addr, size_t bytes, uint64_t pc);
+
+  store_ring_header_t* header;
+  store_ring_entry_t* ring;
+  size_t map_size;
+  uint64_t mask;
+  uint64_t head;
+};
+
+#endif
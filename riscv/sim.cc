@@ -3,14 +3,24 @@
 #include "sim.h"
 #include "mmu.h"
 #include "gdbserver.h"
+#include "profiler.h"
+#include "timing.h"
+#include "trace_writer.h"
+#include "shared_mem.h"
+#include "elf_program.h"
 #include <map>
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <climits>
+#include <cinttypes>
 #include <cstdlib>
 #include <cassert>
 #include <signal.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 volatile bool ctrlc_pressed = false;
 static void handle_signal(int sig)
@@ -21,27 +31,61 @@ static void handle_signal(int sig)
   signal(sig, &handle_signal);
 }
 
+volatile bool stats_requested = false;
+static void handle_stats_signal(int sig)
+{
+  stats_requested = true;
+  signal(sig, &handle_stats_signal);
+}
+
+static char* map_zeroed(size_t size)
+{
+  void* p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  return p == MAP_FAILED ? NULL : (char*)p;
+}
+
 sim_t::sim_t(const char* isa, size_t nprocs, size_t mem_mb, bool halted,
              const std::vector<std::string>& args)
   : htif_t(args), procs(std::max(nprocs, size_t(1))),
-    current_step(0), current_proc(0), debug(false), gdbserver(NULL)
+    current_step(0), current_proc(0), quanta_since_wait(0),
+    debug(false), gdbserver(NULL), stats_interval(0),
+    start_time(clock::now()), last_report(start_time),
+    stats_base(procs.size() * HPM_NUM_EVENTS),
+    last_report_instret(procs.size()), host_switches(0), profiler(NULL),
+    timing(NULL), roi_only(false), tracing(true), checkpoint_requested(false),
+    snapshot_taken(false),
+    host(NULL), tohost_addr(0), host_accesses(0),
+    htif_pending(false)
 {
-  signal(SIGINT, &handle_signal);
+  // fesvr takes the arguments before the program's that start with '+' as
+  // its own
+  for (auto& arg : args) {
+    if (arg[0] != '+') {
+      program = arg;
+      break;
+    }
+  }
+
   // allocate target machine's memory, shrinking it as necessary
-  // until the allocation succeeds
+  // until the allocation succeeds.  It's mapped rather than calloc'd, so
+  // the host zeroes only the pages the target touches.
   size_t memsz0 = (size_t)mem_mb << 20;
   size_t quantum = 1L << 20;
   if (memsz0 == 0)
     memsz0 = (size_t)((sizeof(size_t) == 8 ? 4096 : 2048) - 256) << 20;
 
   memsz = memsz0;
-  while ((mem = (char*)calloc(1, memsz)) == NULL)
+  while ((mem = map_zeroed(memsz)) == NULL)
     memsz = (size_t)(memsz*0.9)/quantum*quantum;
 
   if (memsz != memsz0)
     fprintf(stderr, "warning: only got %zu bytes of target mem (wanted %zu)\n",
             memsz, memsz0);
 
+  code_pages.resize(memsz >> PGSHIFT);
+  reserved_pages.resize(memsz >> PGSHIFT);
+  dirty_pages.resize(memsz >> PGSHIFT);
   bus.add_device(DEBUG_START, &debug_module);
 
   debug_mmu = new mmu_t(this, NULL);
@@ -50,6 +94,8 @@ sim_t::sim_t(const char* isa, size_t nprocs, size_t mem_mb, bool halted,
     procs[i] = new processor_t(isa, this, i, halted);
   }
 
+  set_htif_latency(DEFAULT_HTIF_LATENCY);
+
   rtc.reset(new rtc_t(procs));
   uart.reset(new uart_dev_t);
   plic.reset(new plic_t(1));
@@ -61,7 +107,7 @@ sim_t::~sim_t()
   for (size_t i = 0; i < procs.size(); i++)
     delete procs[i];
   delete debug_mmu;
-  free(mem);
+  munmap(mem, memsz);
 }
 
 void sim_thread_main(void* arg)
@@ -71,8 +117,13 @@ void sim_thread_main(void* arg)
 
 void sim_t::main()
 {
-  if (!debug && log)
+  if (!debug && log && !roi_only)
     set_procs_debug(true);
+  if (roi_only) {
+    set_tracing(false);
+    for (size_t i = 0; i < procs.size(); i++)
+      procs[i]->set_log_commits(false);
+  }
 
   while (!done())
   {
@@ -83,14 +134,34 @@ void sim_t::main()
     if (gdbserver) {
       gdbserver->handle();
     }
+    if (stats_requested) {
+      stats_requested = false;
+      dump_stats();
+    }
+    if (checkpoint_requested) {
+      checkpoint_requested = false;
+      if (checkpoint_handler)
+        checkpoint_handler();
+      else
+        fprintf(stderr, "warning: checkpoint requested, but no handler is installed\n");
+    }
   }
 }
 
 int sim_t::run()
 {
+  // only a machine run by the host loop stops for ctrl-C or dumps its
+  // statistics on SIGUSR1; ones driven by step() leave the signals to
+  // their owner
+  signal(SIGINT, &handle_signal);
+  signal(SIGUSR1, &handle_stats_signal);
+  std::cout << config_string;
   host = context_t::current();
   target.init(sim_thread_main, this);
-  return htif_t::run();
+  int exit_code = htif_t::run();
+  if (!stats_file.empty())
+    dump_stats();
+  return exit_code;
 }
 
 void sim_t::step(size_t n)
@@ -98,18 +169,30 @@ void sim_t::step(size_t n)
   for (size_t i = 0, steps = 0; i < n; i += steps)
   {
     steps = std::min(n - i, INTERLEAVE - current_step);
+    if (timing)
+      timing->switch_to(procs[current_proc]);
     procs[current_proc]->step(steps);
+    if (profiler)
+      profiler->sample(procs[current_proc]);
 
     current_step += steps;
     if (current_step == INTERLEAVE)
     {
       current_step = 0;
-      procs[current_proc]->yield_load_reservation();
       if (++current_proc == procs.size()) {
         current_proc = 0;
         rtc->increment(INTERLEAVE / INSNS_PER_RTC_TICK);
+        if (stats_interval)
+          report_progress();
+      }
+      // there's no host to wait for when the machine is driven by step()
+      // alone, as through libspike.h
+      if (host && (htif_pending || !tohost_addr ||
+                   ++quanta_since_wait >= max_quanta_between_waits)) {
+        htif_pending = false;
+        quanta_since_wait = 0;
+        wait();
       }
-      wait();
     }
   }
 }
@@ -135,6 +218,39 @@ void sim_t::load_mem(const char* fname) {
   fprintf(stdout, "[spike] finish loadmem\n");
 }
 
+void sim_t::map_mem(const char* name, bool shared)
+{
+  int fd = shared_mem_open(name, shared ? O_RDWR | O_CREAT : O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    fprintf(stderr, "could not open %s\n", name);
+    exit(1);
+  }
+  if (shared && (size_t)st.st_size < memsz && ftruncate(fd, memsz) < 0) {
+    fprintf(stderr, "could not size %s\n", name);
+    exit(1);
+  }
+
+  // zeroed memory, with the file mapped over as much of it as it covers
+  size_t file_size = shared ? memsz : std::min((size_t)st.st_size, memsz);
+  size_t host_page = sysconf(_SC_PAGESIZE);
+  file_size = (file_size + host_page - 1) / host_page * host_page;
+  char* m = map_zeroed(memsz);
+  if (!m || (file_size &&
+      mmap(m, file_size, PROT_READ | PROT_WRITE,
+           MAP_FIXED | (shared ? MAP_SHARED : MAP_PRIVATE), fd, 0) == MAP_FAILED)) {
+    fprintf(stderr, "could not map %s\n", name);
+    exit(1);
+  }
+  close(fd);
+
+  munmap(mem, memsz);
+  mem = m;
+  flush_tlbs();
+  for (size_t i = 0; i < procs.size(); i++)
+    procs[i]->get_mmu()->flush_icache();
+}
+
 void sim_t::set_debug(bool value)
 {
   debug = value;
@@ -161,6 +277,120 @@ void sim_t::set_histogram(bool value)
   }
 }
 
+void sim_t::set_insn_mix(bool value)
+{
+  for (size_t i = 0; i < procs.size(); i++)
+    procs[i]->set_insn_mix(value);
+}
+
+void sim_t::set_htif_latency(size_t insns)
+{
+  max_quanta_between_waits = std::max(insns / INTERLEAVE, size_t(1));
+}
+
+void sim_t::set_profiler(profiler_t* p)
+{
+  profiler = p;
+  for (size_t i = 0; i < procs.size(); i++)
+    procs[i]->set_profiler(p);
+}
+
+void sim_t::set_branch_tracer(branch_tracer_t* t)
+{
+  for (size_t i = 0; i < procs.size(); i++)
+    procs[i]->set_branch_tracer(t);
+}
+
+void sim_t::set_timing_model(timing_model_t* t)
+{
+  timing = t;
+  for (size_t i = 0; i < procs.size(); i++)
+    procs[i]->set_timing_model(t);
+}
+
+void sim_t::add_memtracer(size_t core, memtracer_t* t)
+{
+  memtracers.push_back(std::make_pair(core, t));
+  if (tracing)
+    procs.at(core)->get_mmu()->register_memtracer(t);
+}
+
+void sim_t::set_trace_writer(size_t core, trace_writer_t* t)
+{
+  trace_writers.resize(procs.size());
+  trace_writer_t* old = trace_writers.at(core);
+  trace_writers[core] = t;
+  if (tracing) {
+    procs[core]->set_trace_writer(t);
+    if (old)
+      procs[core]->get_mmu()->unregister_access_tracer(old);
+    if (t)
+      procs[core]->get_mmu()->register_access_tracer(t);
+  }
+}
+
+void sim_t::set_tracing(bool value)
+{
+  if (value == tracing)
+    return;
+  tracing = value;
+  for (size_t i = 0; i < trace_writers.size(); i++) {
+    procs[i]->set_trace_writer(value ? trace_writers[i] : NULL);
+    if (!trace_writers[i])
+      continue;
+    if (value)
+      procs[i]->get_mmu()->register_access_tracer(trace_writers[i]);
+    else
+      procs[i]->get_mmu()->unregister_access_tracer(trace_writers[i]);
+  }
+  for (auto& t : memtracers) {
+    if (value)
+      procs[t.first]->get_mmu()->register_memtracer(t.second);
+    else
+      procs[t.first]->get_mmu()->unregister_memtracer(t.second);
+  }
+}
+
+void sim_t::roi(processor_t* p, reg_t op)
+{
+  switch (op) {
+    case ROI_STATS_START:
+      for (size_t i = 0; i < procs.size(); i++)
+        for (size_t e = 0; e < HPM_NUM_EVENTS; e++)
+          stats_base[i * HPM_NUM_EVENTS + e] = procs[i]->get_event_count(hpm_event_t(e));
+      stats_stop.clear();
+      start_time = clock::now();
+      break;
+    case ROI_STATS_STOP:
+      if (!stats_stop.empty())
+        break;
+      for (size_t i = 0; i < procs.size(); i++)
+        for (size_t e = 0; e < HPM_NUM_EVENTS; e++)
+          stats_stop.push_back(procs[i]->get_event_count(hpm_event_t(e)));
+      stop_time = clock::now();
+      break;
+    case ROI_TRACE_ON:
+    case ROI_TRACE_OFF:
+      set_tracing(op == ROI_TRACE_ON);
+      break;
+    case ROI_LOG_ON:
+    case ROI_LOG_OFF:
+      // only switch the logging that -l (or --enable-commitlog) turned on
+      for (size_t i = 0; i < procs.size(); i++) {
+        if (log && !debug)
+          procs[i]->set_debug(op == ROI_LOG_ON);
+        procs[i]->set_log_commits(op == ROI_LOG_ON);
+      }
+      break;
+    case ROI_STATS_DUMP:
+      dump_stats();
+      break;
+    case ROI_CHECKPOINT:
+      checkpoint_requested = true;
+      break;
+  }
+}
+
 void sim_t::set_procs_debug(bool value)
 {
   for (size_t i=0; i< procs.size(); i++)
@@ -181,6 +411,237 @@ bool sim_t::mmio_store(reg_t addr, size_t len, const uint8_t* bytes)
   return bus.store(addr, len, bytes);
 }
 
+bool sim_t::addr_is_htif(reg_t addr)
+{
+  return tohost_addr && (addr >> PGSHIFT) == (tohost_addr >> PGSHIFT);
+}
+
+void sim_t::mark_code_page(reg_t paddr)
+{
+  auto bit = code_pages[(paddr - DRAM_BASE) >> PGSHIFT];
+  if (bit)
+    return;
+
+  bit = true;
+  debug_mmu->flush_store_tlb_page(paddr);
+  for (size_t i = 0; i < procs.size(); i++)
+    procs[i]->get_mmu()->flush_store_tlb_page(paddr);
+}
+
+void sim_t::code_page_written(reg_t paddr)
+{
+  auto bit = code_pages[(paddr - DRAM_BASE) >> PGSHIFT];
+  if (!bit)
+    return;
+
+  bit = false;
+  for (size_t i = 0; i < procs.size(); i++)
+    procs[i]->get_mmu()->flush_icache_page(paddr);
+}
+
+bool sim_t::page_reserved(reg_t paddr)
+{
+  return reserved_pages[(paddr - DRAM_BASE) >> PGSHIFT];
+}
+
+void sim_t::mark_reserved_page(reg_t paddr)
+{
+  // a lone hart's reservation is only broken by its own SC or a trap
+  if (procs.size() == 1 || !addr_is_mem(paddr))
+    return;
+
+  auto bit = reserved_pages[(paddr - DRAM_BASE) >> PGSHIFT];
+  if (bit)
+    return;
+
+  bit = true;
+  debug_mmu->flush_store_tlb_page(paddr);
+  for (size_t i = 0; i < procs.size(); i++)
+    procs[i]->get_mmu()->flush_store_tlb_page(paddr);
+}
+
+void sim_t::reserved_page_written(processor_t* p, reg_t paddr)
+{
+  auto bit = reserved_pages[(paddr - DRAM_BASE) >> PGSHIFT];
+  if (!bit)
+    return;
+
+  reg_t block = paddr & ~(RESERVATION_BYTES - 1);
+  bool held = false;
+  for (size_t i = 0; i < procs.size(); i++) {
+    reg_t& reservation = procs[i]->state.load_reservation;
+    if (procs[i] == p)
+      continue;
+    if (reservation == block)
+      reservation = -1;
+    held |= (reservation & PGMASK) == (paddr & PGMASK);
+  }
+  // the writer's own reservation is marked again when it stops running
+  bit = held;
+}
+
+void sim_t::flush_tlbs()
+{
+  debug_mmu->flush_tlb();
+  for (size_t i = 0; i < procs.size(); i++)
+    procs[i]->get_mmu()->flush_tlb();
+}
+
+void sim_t::page_written(reg_t paddr)
+{
+  auto bit = dirty_pages[(paddr - DRAM_BASE) >> PGSHIFT];
+  if (!snapshot_taken || bit)
+    return;
+
+  bit = true;
+  reg_t page = paddr >> PGSHIFT << PGSHIFT;
+  dirty_list.push_back(page);
+  saved_pages.insert(saved_pages.end(), addr_to_mem(page), addr_to_mem(page) + PGSIZE);
+}
+
+void sim_t::snapshot()
+{
+  for (auto page : dirty_list)
+    dirty_pages[(page - DRAM_BASE) >> PGSHIFT] = false;
+  dirty_list.clear();
+  saved_pages.clear();
+
+  saved_states.clear();
+  saved_mcycles.clear();
+  saved_events.clear();
+  for (size_t i = 0; i < procs.size(); i++) {
+    saved_states.push_back(*procs[i]->get_state());
+    saved_mcycles.push_back(procs[i]->get_mcycle());
+    for (size_t e = 0; e < HPM_NUM_EVENTS; e++)
+      saved_events.push_back(procs[i]->get_event_count(hpm_event_t(e)));
+  }
+  saved_rtc.resize(rtc->size());
+  rtc->load(0, saved_rtc.size(), saved_rtc.data());
+  saved_step = current_step;
+  saved_proc = current_proc;
+  saved_stats_base = stats_base;
+  saved_stats_stop = stats_stop;
+  saved_tohost_addr = tohost_addr;
+  saved_htif_pending = htif_pending;
+
+  // every store must now reach store_slow_path once per page
+  snapshot_taken = true;
+  flush_tlbs();
+}
+
+void sim_t::restore()
+{
+  if (!snapshot_taken)
+    return;
+
+  for (size_t i = 0; i < dirty_list.size(); i++) {
+    reg_t page = dirty_list[i];
+    memcpy(addr_to_mem(page), &saved_pages[i * PGSIZE], PGSIZE);
+    dirty_pages[(page - DRAM_BASE) >> PGSHIFT] = false;
+    code_page_written(page);
+  }
+  dirty_list.clear();
+  saved_pages.clear();
+  // the page tables may have changed back, and the restored pages mustn't
+  // be stored to on the fast path until they're saved again
+  flush_tlbs();
+
+  // the reservations are given up, as their pages may no longer be marked
+  for (size_t i = 0; i < procs.size(); i++) {
+    procs[i]->set_state(saved_states[i], saved_mcycles[i]);
+    procs[i]->yield_load_reservation();
+    for (size_t e = 0; e < HPM_NUM_EVENTS; e++)
+      procs[i]->set_event_count(hpm_event_t(e), saved_events[i * HPM_NUM_EVENTS + e]);
+    last_report_instret[i] = procs[i]->get_event_count(HPM_INSTRET);
+  }
+  stats_base = saved_stats_base;
+  stats_stop = saved_stats_stop;
+  rtc->store(0, saved_rtc.size(), saved_rtc.data());
+  current_step = saved_step;
+  current_proc = saved_proc;
+  tohost_addr = saved_tohost_addr;
+  htif_pending = saved_htif_pending;
+  host_accesses = 0;
+}
+
+void sim_t::report_progress()
+{
+  auto now = clock::now();
+  double elapsed = std::chrono::duration<double>(now - last_report).count();
+  if (elapsed < stats_interval)
+    return;
+
+  for (size_t i = 0; i < procs.size(); i++) {
+    uint64_t instret = procs[i]->get_event_count(HPM_INSTRET);
+    fprintf(stderr, "core %3zu: %.2f MIPS\n", i,
+            (instret - last_report_instret[i]) / elapsed / 1e6);
+    last_report_instret[i] = instret;
+  }
+  last_report = now;
+}
+
+uint64_t sim_t::get_stat(size_t core, hpm_event_t event)
+{
+  size_t i = core * HPM_NUM_EVENTS + event;
+  uint64_t now = stats_stop.empty() ? procs[core]->get_event_count(event) : stats_stop[i];
+  return now - stats_base[i];
+}
+
+void sim_t::dump_stats()
+{
+  static const struct {
+    const char* name;
+    hpm_event_t event;
+  } events[] = {
+    {"instret", HPM_INSTRET},
+    {"loads", HPM_LOAD},
+    {"stores", HPM_STORE},
+    {"amos", HPM_AMO},
+    {"branches", HPM_BRANCH},
+    {"icache_refills", HPM_ICACHE_REFILL},
+    {"itlb_refills", HPM_ITLB_REFILL},
+    {"dtlb_refills", HPM_DTLB_REFILL},
+    {"page_walks", HPM_PAGE_WALK},
+    {"exceptions", HPM_EXCEPTION},
+    {"interrupts", HPM_INTERRUPT},
+    {"mmio_accesses", HPM_MMIO_ACCESS},
+    {"slow_path_entries", HPM_SLOW_PATH},
+    {"muls", HPM_MUL},
+    {"divs", HPM_DIV},
+    {"fp_ops", HPM_FP},
+    {"fp_divs", HPM_FDIV},
+  };
+
+  FILE* out = stderr;
+  if (!stats_file.empty() && stats_file != "-" &&
+      !(out = fopen(stats_file.c_str(), "w"))) {
+    fprintf(stderr, "could not open %s\n", stats_file.c_str());
+    return;
+  }
+
+  auto end_time = stats_stop.empty() ? clock::now() : stop_time;
+  double elapsed = std::chrono::duration<double>(end_time - start_time).count();
+  fprintf(out, "{\n  \"wall_seconds\": %.3f,\n", elapsed);
+  fprintf(out, "  \"host_switches\": %zu,\n", host_switches);
+  fprintf(out, "  \"harts\": [\n");
+  for (size_t i = 0; i < procs.size(); i++) {
+    fprintf(out, "    {\"id\": %zu, \"mips\": %.2f", i,
+            get_stat(i, HPM_INSTRET) / elapsed / 1e6);
+    if (timing) {
+      uint64_t cycles = procs[i]->get_mcycle();
+      fprintf(out, ", \"cycles\": %" PRIu64 ", \"ipc\": %.3f", cycles,
+              cycles ? (double)procs[i]->get_event_count(HPM_INSTRET) / cycles : 0.0);
+    }
+    for (auto& e : events)
+      fprintf(out, ", \"%s\": %" PRIu64, e.name, get_stat(i, e.event));
+    fprintf(out, "}%s\n", i + 1 < procs.size() ? "," : "");
+  }
+  fprintf(out, "  ]\n}\n");
+
+  if (out != stderr)
+    fclose(out);
+}
+
 void sim_t::make_config_string()
 {
   reg_t rtc_addr = 0x0200bff8L;
@@ -257,8 +718,6 @@ void sim_t::make_config_string()
 
   config_string = s.str();
 
-  std::cout << config_string;
-
   rom.insert(rom.end(), config_string.begin(), config_string.end());
   rom.resize((rom.size() / align + 1) * align);
 
@@ -270,17 +729,47 @@ void sim_t::make_config_string()
 
 void sim_t::wait()
 {
+  host_switches++;
   host->switch_to();
 }
 
+void sim_t::load_program()
+{
+  htif_t::load_program();
+
+  // fesvr found tohost among the program's symbols but keeps it to itself,
+  // so read them from the file again, leaving the loaded image alone.  A
+  // program name that isn't a path and isn't in the working directory is
+  // one fesvr found in its install directory, which is spike's too.
+  if (program.empty())
+    return;
+  std::string path = program;
+  if (access(path.c_str(), F_OK) != 0 && path.find('/') == std::string::npos)
+    path = PREFIX "/riscv64-unknown-elf/bin/" + path;
+  elf_program_t elf;
+  elf.load(path.c_str());
+  if (elf.tohost) {
+    tohost_addr = elf.tohost;
+    // stores to the tohost page must now take the MMU slow path
+    for (size_t i = 0; i < procs.size(); i++)
+      procs[i]->get_mmu()->flush_tlb();
+  }
+}
+
 void sim_t::idle()
 {
+  // anything beyond the single tohost poll means the host is mid-request
+  // (e.g. draining its fromhost queue), so come back after the next quantum
+  htif_pending = host_accesses > 1;
+  host_accesses = 0;
+
   target.switch_to();
 }
 
 void sim_t::read_chunk(addr_t taddr, size_t len, void* dst)
 {
   assert(len == 8);
+  host_accesses++;
   auto data = debug_mmu->load_uint64(taddr);
   memcpy(dst, &data, sizeof data);
 }
@@ -288,6 +777,7 @@ void sim_t::read_chunk(addr_t taddr, size_t len, void* dst)
 void sim_t::write_chunk(addr_t taddr, size_t len, const void* src)
 {
   assert(len == 8);
+  host_accesses++;
   uint64_t data;
   memcpy(&data, src, sizeof data);
   debug_mmu->store_uint64(taddr, data);
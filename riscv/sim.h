@@ -6,14 +6,21 @@
 #include "processor.h"
 #include "devices.h"
 #include "debug_module.h"
+#include "memtracer.h"
 #include <fesvr/htif.h>
 #include <fesvr/context.h>
 #include <vector>
 #include <string>
 #include <memory>
+#include <chrono>
+#include <functional>
 
 class mmu_t;
 class gdbserver_t;
+class profiler_t;
+class branch_tracer_t;
+class timing_model_t;
+class trace_writer_t;
 
 // this class encapsulates the processors and memory in a RISC-V machine.
 class sim_t : public htif_t
@@ -29,14 +36,51 @@ public:
   void set_log(bool value);
   void set_lockstep(bool value);
   void set_histogram(bool value);
+  void set_insn_mix(bool value);
   void set_procs_debug(bool value);
+  void set_htif_latency(size_t insns);
+  void set_stats_file(const char* path) { stats_file = path; }
+  void set_stats_interval(double seconds) { stats_interval = seconds; }
+  void dump_stats(); // write the simulator's own statistics as JSON
+  void set_profiler(profiler_t* p);
+  void set_branch_tracer(branch_tracer_t* t);
+  void set_timing_model(timing_model_t* t);
+
+  // memtracers attached to a core's MMU that the guest can switch on and
+  // off with region-of-interest hints (see roi_op_t)
+  void add_memtracer(size_t core, memtracer_t* t);
+  // and, like them, an instruction trace for a core
+  void set_trace_writer(size_t core, trace_writer_t* t);
+  // leave tracing and logging off until the guest asks for them
+  void set_roi(bool value) { roi_only = value; }
+  void set_checkpoint_handler(std::function<void()> f) { checkpoint_handler = f; }
   void set_gdbserver(gdbserver_t* gdbserver) { this->gdbserver = gdbserver; }
   const char* get_config_string() { return config_string.c_str(); }
   processor_t* get_core(size_t i) { return procs.at(i); }
   processor_t* current_core() { return procs[current_proc]; }
+  size_t num_cores() { return procs.size(); }
+  size_t get_mem_size() { return memsz; } // bytes of memory at DRAM_BASE
+  // physical accesses to memory and devices, as the debugger makes them
+  mmu_t* get_debug_mmu() { return debug_mmu; }
+  void add_device(reg_t addr, abstract_device_t* dev) { bus.add_device(addr, dev); }
 
   void step(size_t n); // step through simulation
   void load_mem(const char* fname);
+  // back target memory with a file or "shm:<name>" that another process
+  // can map too.  Shared, the target's stores go to it; otherwise it's
+  // golden data the target sees a private copy of.
+  void map_mem(const char* name, bool shared);
+
+  // Reuse one machine for many short runs, e.g. fuzzing test cases:
+  // snapshot() records the harts, devices and memory as they are now, and
+  // restore() puts them back, copying only the pages written since.  The
+  // harts' event counts (so their mhpmcounters and --stats) and the HTIF
+  // state go back too.  The attached models (caches, branch predictor,
+  // timing model, profiler, traces) and the instruction mix and PC
+  // histogram keep what they saw since the snapshot, and LR reservations
+  // are given up.
+  void snapshot();
+  void restore();
 private:
   char* mem; // main memory
   size_t memsz; // memory size in bytes
@@ -53,19 +97,87 @@ private:
   processor_t* get_core(const std::string& i);
   static const size_t INTERLEAVE = 5000;
   static const size_t INSNS_PER_RTC_TICK = 100; // 10 MHz clock for 1 BIPS core
+  static const size_t DEFAULT_HTIF_LATENCY = 1000000; // insns between polls
   size_t current_step;
   size_t current_proc;
+  size_t quanta_since_wait;
+  size_t max_quanta_between_waits;
   bool debug;
   bool log;
   bool histogram_enabled; // provide a histogram of PCs
   gdbserver_t* gdbserver;
 
+  // self-instrumentation: per-hart counts live in processor_t::hpm_events
+  typedef std::chrono::steady_clock clock;
+  std::string stats_file; // "-" for stderr, empty to skip the dump at exit
+  double stats_interval; // seconds between MIPS reports, or 0 for none
+  clock::time_point start_time;
+  clock::time_point stop_time;
+  clock::time_point last_report;
+  std::vector<uint64_t> stats_base; // event counts when statistics started
+  std::vector<uint64_t> stats_stop; // and when they stopped, if they have
+  std::vector<uint64_t> last_report_instret;
+  size_t host_switches;
+  uint64_t get_stat(size_t core, hpm_event_t event);
+  void report_progress();
+  profiler_t* profiler;
+  timing_model_t* timing;
+
+  // region of interest
+  bool roi_only;
+  bool tracing;
+  bool checkpoint_requested;
+  std::vector<std::pair<size_t, memtracer_t*>> memtracers;
+  std::vector<trace_writer_t*> trace_writers; // by core
+  std::function<void()> checkpoint_handler;
+  void roi(processor_t* p, reg_t op);
+  void set_tracing(bool value);
+
   // memory-mapped I/O routines
   bool addr_is_mem(reg_t addr) {
     return addr >= DRAM_BASE && addr < DRAM_BASE + memsz;
   }
   char* addr_to_mem(reg_t addr) { return mem + addr - DRAM_BASE; }
   reg_t mem_to_addr(char* x) { return x - mem + DRAM_BASE; }
+  bool addr_is_htif(reg_t addr);
+
+  // pages of memory holding instructions that some icache has decoded.
+  // Stores to them are kept off the TLB fast path, so the first store to
+  // such a page can drop the stale decodes and clear its bit.
+  std::vector<bool> code_pages;
+  void mark_code_page(reg_t paddr);
+  void code_page_written(reg_t paddr);
+
+  // pages of memory holding an LR reservation, which covers the
+  // RESERVATION_BYTES block around the address loaded.  A hart's page is
+  // marked when it stops running with a reservation held; stores to it are
+  // then kept off the TLB fast path, so the first store by another hart can
+  // break the reservations on its block and clear the bit.
+  static const reg_t RESERVATION_BYTES = 64;
+  std::vector<bool> reserved_pages;
+  bool page_reserved(reg_t paddr);
+  void mark_reserved_page(reg_t paddr);
+  void reserved_page_written(processor_t* p, reg_t paddr);
+
+  // while a snapshot is held, the first store to each page since it was
+  // taken saves the page's contents.  Stores to pages not yet saved are
+  // kept off the TLB fast path, as for code pages.
+  bool snapshot_taken;
+  std::vector<bool> dirty_pages;
+  std::vector<reg_t> dirty_list; // their addresses, in the order written
+  std::vector<char> saved_pages; // and their contents at the snapshot
+  std::vector<state_t> saved_states;
+  std::vector<reg_t> saved_mcycles;
+  std::vector<uint64_t> saved_events; // HPM_NUM_EVENTS for each hart
+  std::vector<uint64_t> saved_stats_base, saved_stats_stop;
+  std::vector<uint8_t> saved_rtc;
+  size_t saved_step;
+  size_t saved_proc;
+  reg_t saved_tohost_addr;
+  bool saved_htif_pending;
+  void page_written(reg_t paddr);
+  void flush_tlbs();
+
   bool mmio_load(reg_t addr, size_t len, uint8_t* bytes);
   bool mmio_store(reg_t addr, size_t len, const uint8_t* bytes);
   void make_config_string();
@@ -101,7 +213,16 @@ private:
 
   context_t* host;
   context_t target;
+  // The host only needs to run when the target has touched tohost/fromhost
+  // or when it was busy servicing a request during its last turn.  tohost is
+  // the program's tohost symbol; if it isn't known, the host runs after
+  // every quantum.
+  std::string program; // the target program, as fesvr will load it
+  reg_t tohost_addr;
+  size_t host_accesses;
+  bool htif_pending;
   void reset() { }
+  void load_program();
   void idle();
   virtual void wait();
   void read_chunk(addr_t taddr, size_t len, void* dst);
@@ -111,5 +232,6 @@ private:
 };
 
 extern volatile bool ctrlc_pressed;
+extern volatile bool stats_requested;
 
 #endif
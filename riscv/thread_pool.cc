@@ -0,0 +1,58 @@
+// See LICENSE for license details.
+
+#include "thread_pool.h"
+#include <algorithm>
+
+thread_pool_t::thread_pool_t(size_t threads)
+  : busy(0), stop(false)
+{
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  for (size_t i = 0; i < threads; i++)
+    workers.emplace_back(&thread_pool_t::run, this);
+}
+
+thread_pool_t::~thread_pool_t()
+{
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stop = true;
+  }
+  work_ready.notify_all();
+  for (auto& t : workers)
+    t.join();
+}
+
+void thread_pool_t::submit(std::function<void()> task)
+{
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    tasks.push_back(std::move(task));
+  }
+  work_ready.notify_one();
+}
+
+void thread_pool_t::wait()
+{
+  std::unique_lock<std::mutex> guard(lock);
+  work_done.wait(guard, [this]{ return tasks.empty() && busy == 0; });
+}
+
+void thread_pool_t::run()
+{
+  std::unique_lock<std::mutex> guard(lock);
+  while (true) {
+    work_ready.wait(guard, [this]{ return stop || !tasks.empty(); });
+    if (tasks.empty())
+      return;
+
+    auto task = std::move(tasks.front());
+    tasks.pop_front();
+    busy++;
+    guard.unlock();
+    task();
+    guard.lock();
+    if (--busy == 0 && tasks.empty())
+      work_done.notify_all();
+  }
+}
@@ -0,0 +1,39 @@
+// See LICENSE for license details.
+
+#ifndef _RISCV_THREAD_POOL_H
+#define _RISCV_THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads running tasks in the order they're
+// submitted.
+class thread_pool_t
+{
+ public:
+  // threads = 0 means one per host CPU
+  thread_pool_t(size_t threads = 0);
+  ~thread_pool_t();
+
+  size_t size() { return workers.size(); }
+  void submit(std::function<void()> task);
+  // wait until every task submitted so far has finished
+  void wait();
+
+ private:
+  void run();
+
+  std::mutex lock;
+  std::condition_variable work_ready;
+  std::condition_variable work_done;
+  std::deque<std::function<void()>> tasks;
+  size_t busy;
+  bool stop;
+  std::vector<std::thread> workers;
+};
+
+#endif
@@ -0,0 +1,124 @@
+// See LICENSE for license details.
+
+#include "timing.h"
+#include "processor.h"
+#include "cachesim.h"
+#include "branchpred.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+static const char* latency_names[] = {
+  "mul", "div", "fp", "fdiv", "load", "store", "amo",
+  "l2", "mem", "walk", "mispredict", "trap"
+};
+
+static void help()
+{
+  std::cerr << "Timing configurations are comma-separated lists of name=cycles," << std::endl;
+  std::cerr << "or \"default\", where name is one of" << std::endl;
+  std::cerr << "  mul, div      extra cycles for integer multiplies and divides" << std::endl;
+  std::cerr << "  fp, fdiv      extra cycles for FP operations and FP divides/roots" << std::endl;
+  std::cerr << "  load, store, amo  extra cycles for each memory access" << std::endl;
+  std::cerr << "  l2            an L1 miss that the L2 model holds" << std::endl;
+  std::cerr << "  mem           a miss in the last cache level modeled" << std::endl;
+  std::cerr << "  walk          a page-table walk" << std::endl;
+  std::cerr << "  mispredict    a branch mispredicted by the --bpred model" << std::endl;
+  std::cerr << "  trap          an exception or interrupt" << std::endl;
+  exit(1);
+}
+
+timing_model_t::timing_model_t(const char* config, size_t nprocs)
+  : l2(NULL), bpred(NULL), current(NULL), l1_misses(0), l2_misses(0),
+    stall(nprocs)
+{
+  static const uint64_t defaults[NUM_LATENCIES] = {
+    2, 20, 3, 15, 0, 0, 10, 10, 100, 20, 3, 10
+  };
+  memcpy(latency, defaults, sizeof(latency));
+  l1[0] = l1[1] = NULL;
+
+  if (strcmp(config, "default") == 0)
+    config = "";
+  for (const char* p = config; *p; ) {
+    const char* eq = strchr(p, '=');
+    if (!eq)
+      help();
+    std::string name(p, eq);
+    char* end;
+    uint64_t value = strtoull(eq + 1, &end, 0);
+    if (end == eq + 1 || (*end && *end != ','))
+      help();
+
+    size_t i = 0;
+    while (i < NUM_LATENCIES && name != latency_names[i])
+      i++;
+    if (i == NUM_LATENCIES)
+      help();
+    latency[i] = value;
+    p = *end ? end + 1 : end;
+  }
+}
+
+void timing_model_t::set_caches(cache_sim_t* ic, cache_sim_t* dc, cache_sim_t* l2cache)
+{
+  l1[0] = ic;
+  l1[1] = dc;
+  l2 = l2cache;
+}
+
+uint64_t timing_model_t::pending_stall()
+{
+  uint64_t l1_now = 0, l2_now = l2 ? l2->get_misses() : 0;
+  for (auto c : l1)
+    if (c)
+      l1_now += c->get_misses();
+
+  // without an L2 model, every L1 miss goes to memory
+  if (!l2)
+    return (l1_now - l1_misses) * latency[LAT_MEM];
+  return (l1_now - l1_misses) * latency[LAT_L2] +
+         (l2_now - l2_misses) * latency[LAT_MEM];
+}
+
+void timing_model_t::switch_to(processor_t* p)
+{
+  if (current)
+    stall[current->get_id()] += pending_stall();
+  current = p;
+
+  l1_misses = 0;
+  for (auto c : l1)
+    if (c)
+      l1_misses += c->get_misses();
+  l2_misses = l2 ? l2->get_misses() : 0;
+}
+
+uint64_t timing_model_t::cycles(processor_t* p)
+{
+  static const struct {
+    hpm_event_t event;
+    latency_t latency;
+  } costs[] = {
+    {HPM_MUL, LAT_MUL},
+    {HPM_DIV, LAT_DIV},
+    {HPM_FP, LAT_FP},
+    {HPM_FDIV, LAT_FDIV},
+    {HPM_LOAD, LAT_LOAD},
+    {HPM_STORE, LAT_STORE},
+    {HPM_AMO, LAT_AMO},
+    {HPM_PAGE_WALK, LAT_WALK},
+    {HPM_EXCEPTION, LAT_TRAP},
+    {HPM_INTERRUPT, LAT_TRAP},
+  };
+
+  uint64_t cycles = p->get_event_count(HPM_INSTRET) + stall[p->get_id()];
+  for (auto& c : costs)
+    cycles += p->get_event_count(c.event) * latency[c.latency];
+  if (bpred)
+    cycles += bpred->get_mispredicts(p->get_id()) * latency[LAT_MISPREDICT];
+  if (p == current)
+    cycles += pending_stall();
+  return cycles;
+}
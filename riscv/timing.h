@@ -0,0 +1,51 @@
+// See LICENSE for license details.
+
+#ifndef _RISCV_TIMING_H
+#define _RISCV_TIMING_H
+
+#include "decode.h"
+#include <vector>
+
+class processor_t;
+class cache_sim_t;
+class branch_predictor_t;
+
+// A simple in-order timing model.  Each instruction costs a cycle, plus
+// a configurable penalty for each event it causes: a long-latency
+// operation, a cache miss, a page walk, a mispredict or a trap.  All of
+// these are already counted elsewhere, so the model keeps no per-instruction
+// state; it turns the counts into cycles whenever mcycle is read.
+class timing_model_t
+{
+ public:
+  // config is a comma-separated list of name=cycles (see help)
+  timing_model_t(const char* config, size_t nprocs);
+
+  // the cache models and predictor whose misses and mispredicts cost time
+  void set_caches(cache_sim_t* ic, cache_sim_t* dc, cache_sim_t* l2);
+  void set_branch_predictor(branch_predictor_t* bp) { bpred = bp; }
+
+  // p is about to run; cache misses until the next switch are charged to it
+  void switch_to(processor_t* p);
+  uint64_t cycles(processor_t* p);
+
+ private:
+  enum latency_t {
+    LAT_MUL, LAT_DIV, LAT_FP, LAT_FDIV, LAT_LOAD, LAT_STORE, LAT_AMO,
+    LAT_L2, LAT_MEM, LAT_WALK, LAT_MISPREDICT, LAT_TRAP, NUM_LATENCIES
+  };
+
+  uint64_t pending_stall();
+
+  uint64_t latency[NUM_LATENCIES];
+  cache_sim_t* l1[2];
+  cache_sim_t* l2;
+  branch_predictor_t* bpred;
+
+  processor_t* current;
+  uint64_t l1_misses; // as of the last switch
+  uint64_t l2_misses;
+  std::vector<uint64_t> stall; // memory stalls charged to each hart
+};
+
+#endif
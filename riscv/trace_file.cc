@@ -0,0 +1,329 @@
+// See LICENSE for license details.
+
+#include "trace_file.h"
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MIN_MATCH 4
+#define MAX_OFFSET 65535
+#define HASH_BITS 13
+
+static uint32_t read32(const uint8_t* p)
+{
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static uint64_t get_le(const uint8_t* p, size_t bytes)
+{
+  uint64_t v = 0;
+  for (size_t i = 0; i < bytes; i++)
+    v |= uint64_t(p[i]) << (8 * i);
+  return v;
+}
+
+static uint8_t* put_length(uint8_t* op, size_t len)
+{
+  for ( ; len >= 255; len -= 255)
+    *op++ = 255;
+  *op++ = len;
+  return op;
+}
+
+static bool get_length(const uint8_t*& ip, const uint8_t* end, size_t& len)
+{
+  uint8_t b;
+  do {
+    if (ip == end)
+      return false;
+    len += b = *ip++;
+  } while (b == 255);
+  return true;
+}
+
+size_t tracez_bound(size_t n)
+{
+  return n + n / 255 + 16;
+}
+
+size_t tracez_compress(const uint8_t* in, size_t n, uint8_t* out)
+{
+  uint32_t table[1 << HASH_BITS] = {0};
+  const uint8_t *ip = in, *anchor = in, *end = in + n;
+  const uint8_t* limit = n >= MIN_MATCH ? end - MIN_MATCH : in;
+  uint8_t* op = out;
+
+  while (ip < limit) {
+    uint32_t v = read32(ip);
+    uint32_t h = (v * 2654435761u) >> (32 - HASH_BITS);
+    const uint8_t* ref = in + table[h];
+    table[h] = ip - in;
+    if (ref >= ip || ip - ref > MAX_OFFSET || read32(ref) != v) {
+      ip++;
+      continue;
+    }
+
+    const uint8_t *mp = ip + MIN_MATCH, *rp = ref + MIN_MATCH;
+    while (mp < end && *mp == *rp)
+      mp++, rp++;
+
+    size_t lit = ip - anchor, match = mp - ip - MIN_MATCH, off = ip - ref;
+    *op++ = (std::min(lit, size_t(15)) << 4) | std::min(match, size_t(15));
+    if (lit >= 15)
+      op = put_length(op, lit - 15);
+    memcpy(op, anchor, lit);
+    op += lit;
+    *op++ = off;
+    *op++ = off >> 8;
+    if (match >= 15)
+      op = put_length(op, match - 15);
+    ip = anchor = mp;
+  }
+
+  size_t lit = end - anchor;
+  *op++ = std::min(lit, size_t(15)) << 4;
+  if (lit >= 15)
+    op = put_length(op, lit - 15);
+  memcpy(op, anchor, lit);
+  return op + lit - out;
+}
+
+bool tracez_decompress(const uint8_t* in, size_t n, uint8_t* out, size_t out_n)
+{
+  const uint8_t *ip = in, *iend = in + n;
+  uint8_t *op = out, *oend = out + out_n;
+
+  while (ip < iend) {
+    uint8_t token = *ip++;
+    size_t lit = token >> 4;
+    if (lit == 15 && !get_length(ip, iend, lit))
+      return false;
+    if (lit > size_t(iend - ip) || lit > size_t(oend - op))
+      return false;
+    memcpy(op, ip, lit);
+    ip += lit;
+    op += lit;
+    if (ip == iend)
+      break;
+
+    if (iend - ip < 2)
+      return false;
+    size_t off = ip[0] | (ip[1] << 8);
+    ip += 2;
+    size_t match = token & 15;
+    if (match == 15 && !get_length(ip, iend, match))
+      return false;
+    match += MIN_MATCH;
+    if (off == 0 || off > size_t(op - out) || match > size_t(oend - op))
+      return false;
+    // the match may overlap what it's copying
+    for (const uint8_t* ref = op - off; match > 0; match--)
+      *op++ = *ref++;
+  }
+  return op == oend;
+}
+
+trace_reader_t::trace_reader_t()
+  : data(NULL), data_size(0), version(0), records(0), block(0), pos(0), record(0)
+{
+}
+
+trace_reader_t::~trace_reader_t()
+{
+  close();
+}
+
+void trace_reader_t::close()
+{
+  if (data)
+    munmap((void*)data, data_size);
+  data = NULL;
+  data_size = 0;
+}
+
+bool trace_reader_t::fail(const std::string& why)
+{
+  err = why;
+  return false;
+}
+
+bool trace_reader_t::open(const char* path)
+{
+  close();
+  index.clear();
+  err.clear();
+  records = 0;
+
+  int fd = ::open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    if (fd >= 0)
+      ::close(fd);
+    return fail(std::string("could not open ") + path);
+  }
+  void* map = st.st_size ? mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  ::close(fd);
+  if (map == MAP_FAILED)
+    return fail(std::string("could not map ") + path);
+  data = (const uint8_t*)map;
+  data_size = st.st_size;
+
+  const size_t header = 16, footer = 32;
+  if (data_size < header + footer || memcmp(data, TRACE_MAGIC, 8) != 0)
+    return fail(std::string(path) + " is not a trace");
+  version = get_le(data + 8, 4);
+  if (version < 1 || version > TRACE_VERSION)
+    return fail(std::string(path) + " has an unsupported trace version");
+  const uint8_t* tail = data + data_size - footer;
+  if (memcmp(tail + 24, TRACE_INDEX_MAGIC, 8) != 0)
+    return fail(std::string(path) + " has no index; was the trace finished?");
+
+  uint64_t blocks = get_le(tail, 8);
+  uint64_t index_offset = get_le(tail + 16, 8);
+  records = get_le(tail + 8, 8);
+  if (index_offset > data_size - footer ||
+      blocks > (data_size - footer - index_offset) / 16)
+    return fail(std::string(path) + " has a truncated index");
+  for (size_t i = 0; i < blocks; i++) {
+    const uint8_t* entry = data + index_offset + 16*i;
+    index.push_back({get_le(entry, 8), get_le(entry + 8, 8)});
+  }
+
+  return seek(0);
+}
+
+bool trace_reader_t::load_block(size_t b)
+{
+  uint64_t offset = index[b].offset;
+  if (offset > data_size || data_size - offset < 16)
+    return fail("truncated block");
+
+  const uint8_t* header = data + offset;
+  size_t packed = get_le(header + 4, 4);
+  raw.resize(get_le(header, 4));
+  if (data_size - offset - 16 < packed ||
+      !tracez_decompress(header + 16, packed, raw.data(), raw.size()))
+    return fail("corrupt block");
+
+  block = b;
+  pos = 0;
+  record = index[b].first_record;
+  last_pc = next_pc = last_addr = bias = 0;
+  memset(regs, 0, sizeof(regs));
+  return true;
+}
+
+bool trace_reader_t::seek(uint64_t n)
+{
+  if (!data)
+    return fail("no trace open");
+  if (n >= records) {
+    // leave the reader at the end
+    block = index.size();
+    raw.clear();
+    pos = 0;
+    record = records;
+    return n == records;
+  }
+
+  auto it = std::upper_bound(index.begin(), index.end(), n,
+    [](uint64_t n, const block_t& b) { return n < b.first_record; });
+  if (!load_block(it - index.begin() - 1))
+    return false;
+
+  trace_record_t rec;
+  while (record < n)
+    if (!next(rec))
+      return false;
+  return true;
+}
+
+bool trace_reader_t::next(trace_record_t& rec)
+{
+  if (pos == raw.size()) {
+    if (block + 1 >= index.size() || record >= records)
+      return false;
+    if (!load_block(block + 1))
+      return false;
+  }
+
+  const uint8_t *p = &raw[pos], *end = raw.data() + raw.size();
+  #define need(n) if (size_t(end - p) < (n)) return fail("truncated record")
+  auto varint = [&](uint64_t& x) {
+    x = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+      x |= uint64_t(*p & 0x7f) << shift;
+      if (!(*p++ & 0x80))
+        return true;
+    }
+    return false;
+  };
+
+  uint64_t x;
+  need(1);
+  uint8_t flags = *p++;
+  rec.pc = next_pc;
+  if (flags & TRACE_PC_DELTA) {
+    if (!varint(x))
+      return fail("truncated record");
+    rec.pc = last_pc + trace_unzigzag(x);
+  }
+  if (flags & TRACE_FETCH_BIAS) {
+    if (!varint(x))
+      return fail("truncated record");
+    bias = trace_unzigzag(x);
+  }
+  rec.fetch_addr = rec.pc + bias;
+
+  need(2);
+  size_t len = trace_insn_length(p[0]);
+  need(len);
+  rec.insn = get_le(p, len);
+  p += len;
+
+  rec.reg = -1;
+  rec.value = 0;
+  if (flags & TRACE_REG_WRITE) {
+    need(1);
+    rec.reg = *p++ & 63;
+    if (!varint(x))
+      return fail("truncated record");
+    rec.value = regs[rec.reg] += trace_unzigzag(x);
+  }
+
+  rec.jumped = flags & TRACE_JUMP;
+  rec.npc = rec.pc + len;
+  if (rec.jumped) {
+    if (!varint(x))
+      return fail("truncated record");
+    rec.npc = rec.pc + trace_unzigzag(x);
+  }
+
+  uint64_t count = flags >> TRACE_ACCESS_SHIFT;
+  if (count == TRACE_ACCESS_ESCAPE && version >= 3 && !varint(count))
+    return fail("truncated record");
+  // each access takes at least two bytes
+  need(count);
+  need(2 * count);
+  rec.accesses.resize(count);
+  for (auto& a : rec.accesses) {
+    uint8_t type = *p++;
+    if (!varint(x))
+      return fail("truncated record");
+    a.store = type & TRACE_ACCESS_STORE;
+    a.size = type & 15;
+    a.addr = last_addr += trace_unzigzag(x);
+  }
+  #undef need
+
+  last_pc = rec.pc;
+  next_pc = rec.npc;
+  pos = p - raw.data();
+  record++;
+  return true;
+}
@@ -0,0 +1,175 @@
+// See LICENSE for license details.
+
+#ifndef _RISCV_TRACE_FILE_H
+#define _RISCV_TRACE_FILE_H
+
+// Instruction trace files, as written by --trace (see trace_writer.h), and a
+// reader for them that needs only the standard library and POSIX mmap.
+//
+// A trace holds one record per instruction a hart retires: its pc, the
+// physical address it was fetched from and its encoding, the register it wrote, the loads and stores it made and where
+// it jumped.  The file is a header, a sequence of independently compressed
+// blocks, an index of the blocks and a footer:
+//
+//   header   "SPKTRACE" version:u32 reserved:u32
+//   block    raw_size:u32 packed_size:u32 records:u32 reserved:u32
+//            packed_size bytes of records, compressed with tracez_compress
+//   ...
+//   index    for each block, offset:u64 first_record:u64
+//   footer   blocks:u64 records:u64 index_offset:u64 "SPKTIDX\0"
+//
+// Integers are little-endian.  Each block starts from a clean delta state,
+// so a reader can start at any block the index points to.  A record is
+//
+//   flags:u8     bit 0      pc isn't the previous record's next pc
+//                bit 1      the instruction wrote a register
+//                bit 2      it jumped: its next pc isn't pc + length
+//                bit 3      its physical pc - pc isn't the previous record's
+//                bits 4-7   number of memory accesses, or 15 if more than
+//                           14 (a vector load or store can make hundreds)
+//   pc           if bit 0: pc - previous pc
+//   bias         if bit 3: physical pc - pc (0 before a block's first record)
+//   insn         2, 4, 6 or 8 bytes, as in memory
+//   reg, value   if bit 1: reg:u8 is x0-x31 as 0-31 and f0-f31 as 32-63, and
+//                value - the last value written to reg in this block
+//   target       if bit 2: next pc - pc
+//   count        if bits 4-7 are 15: the number of accesses, unsigned
+//   accesses     for each, type:u8 (bit 7 set for stores, bits 0-3 the size
+//                in bytes) and physical address - previous access's address
+//
+// Differences are zigzag-encoded and written as LEB128 varints.  Traps and
+// interrupts don't appear as records; the first record of the handler has
+// bit 0 set.
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#define TRACE_MAGIC "SPKTRACE"
+#define TRACE_INDEX_MAGIC "SPKTIDX"
+// version 1 had no physical pcs, and versions 1 and 2 no access count
+// escape: 15 in bits 4-7 meant 15 accesses, and later ones were dropped
+#define TRACE_VERSION 3
+
+enum {
+  TRACE_PC_DELTA = 1,
+  TRACE_REG_WRITE = 2,
+  TRACE_JUMP = 4,
+  TRACE_FETCH_BIAS = 8,
+  TRACE_ACCESS_SHIFT = 4,
+  TRACE_ACCESS_ESCAPE = 15,
+  TRACE_ACCESS_STORE = 0x80,
+};
+
+struct trace_access_t
+{
+  uint64_t addr;
+  uint8_t size;
+  bool store;
+};
+
+struct trace_record_t
+{
+  uint64_t pc;
+  uint64_t fetch_addr; // the physical address pc was fetched from
+  uint64_t insn;
+  uint64_t npc;      // the pc of the next instruction executed, or the trap
+                     // handler if the next one trapped
+  int reg;           // register written as in the file, or -1
+  uint64_t value;
+  bool jumped;
+  std::vector<trace_access_t> accesses;
+};
+
+// trace_reader_t r;
+// if (!r.open("prog.trace")) { fprintf(stderr, "%s\n", r.error()); ... }
+// trace_record_t rec;
+// while (r.next(rec)) ...
+//
+// The file is mapped into memory and each block is decompressed as the
+// reader reaches it.
+class trace_reader_t
+{
+ public:
+  trace_reader_t();
+  ~trace_reader_t();
+
+  bool open(const char* path);
+  // false at the end of the trace, or on an error if error() isn't empty
+  bool next(trace_record_t& rec);
+  // position the reader so next returns record n (counting from 0)
+  bool seek(uint64_t n);
+  uint64_t size() { return records; }
+  const char* error() { return err.c_str(); }
+
+ private:
+  struct block_t
+  {
+    uint64_t offset;
+    uint64_t first_record;
+  };
+
+  bool fail(const std::string& why);
+  bool load_block(size_t b);
+  void close();
+
+  const uint8_t* data;
+  size_t data_size;
+  uint32_t version;
+  std::string err;
+  std::vector<block_t> index;
+  uint64_t records;
+
+  // the decompressed block being read
+  size_t block;
+  std::vector<uint8_t> raw;
+  size_t pos;
+  uint64_t record;
+  uint64_t last_pc, next_pc, last_addr, bias;
+  uint64_t regs[64];
+};
+
+// A small LZ77 codec for trace blocks.  Compressed data is a series of
+// sequences, each a token byte (literal count in the high nibble, match
+// length - 4 in the low nibble; 15 means more length bytes follow, each
+// added until one is below 255), the literals, and a 16-bit offset back to
+// the match.  The last sequence has literals only.
+size_t tracez_bound(size_t n);
+size_t tracez_compress(const uint8_t* in, size_t n, uint8_t* out);
+// false unless in decompresses to exactly out_n bytes
+bool tracez_decompress(const uint8_t* in, size_t n, uint8_t* out, size_t out_n);
+
+static inline uint8_t* trace_put_varint(uint8_t* p, uint64_t x)
+{
+  while (x >= 0x80) {
+    *p++ = x | 0x80;
+    x >>= 7;
+  }
+  *p++ = x;
+  return p;
+}
+
+static inline uint64_t trace_zigzag(uint64_t x)
+{
+  return (x << 1) ^ -(x >> 63);
+}
+
+static inline uint64_t trace_unzigzag(uint64_t x)
+{
+  return (x >> 1) ^ -(x & 1);
+}
+
+// the length of an instruction from the low bits of its encoding
+static inline size_t trace_insn_length(uint64_t insn)
+{
+  if ((insn & 3) != 3)
+    return 2;
+  if ((insn & 0x1f) != 0x1f)
+    return 4;
+  if ((insn & 0x3f) == 0x1f)
+    return 6;
+  return 8;
+}
+
+#endif
@@ -0,0 +1,172 @@
+// See LICENSE for license details.
+
+#include "trace_writer.h"
+#include "processor.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+static void put_le(std::vector<uint8_t>& buf, uint64_t x, size_t bytes)
+{
+  for (size_t i = 0; i < bytes; i++)
+    buf.push_back(x >> (8 * i));
+}
+
+trace_writer_t::trace_writer_t(const char* path)
+  : records(0), fetch_addr(0), done(false)
+{
+  if (!(file = fopen(path, "wb"))) {
+    fprintf(stderr, "could not open %s\n", path);
+    exit(1);
+  }
+
+  std::vector<uint8_t> header(TRACE_MAGIC, TRACE_MAGIC + 8);
+  put_le(header, TRACE_VERSION, 4);
+  put_le(header, 0, 4);
+  fwrite(header.data(), 1, header.size(), file);
+
+  start_block();
+  thread = std::thread(&trace_writer_t::write_blocks, this);
+}
+
+trace_writer_t::~trace_writer_t()
+{
+  if (pos != cur.raw.data())
+    flush_block();
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    done = true;
+  }
+  cond.notify_all();
+  thread.join();
+  fclose(file);
+}
+
+void trace_writer_t::start_block()
+{
+  cur.raw.resize(BLOCK_SIZE + MAX_RECORD);
+  cur.first_record = records;
+  cur.records = 0;
+  pos = cur.raw.data();
+  end = pos + BLOCK_SIZE;
+
+  last_pc = next_pc = last_addr = bias = 0;
+  memset(regs, 0, sizeof(regs));
+}
+
+void trace_writer_t::flush_block()
+{
+  cur.raw.resize(pos - cur.raw.data());
+  {
+    std::unique_lock<std::mutex> guard(lock);
+    cond.wait(guard, [this]{ return queue.size() < MAX_QUEUED; });
+    queue.push_back(std::move(cur));
+  }
+  cond.notify_all();
+  cur = block_t();
+  start_block();
+}
+
+void trace_writer_t::retire(reg_t pc, insn_t insn, reg_t npc, const commit_log_reg_t& write)
+{
+  // a record with many accesses may not fit in the space left for one
+  size_t room = cur.raw.data() + cur.raw.size() - pos;
+  size_t need = MAX_RECORD + accesses.size() * MAX_ACCESS;
+  if (unlikely(room < need)) {
+    size_t used = pos - cur.raw.data();
+    cur.raw.resize(used + need);
+    pos = cur.raw.data() + used;
+    end = cur.raw.data() + BLOCK_SIZE;
+  }
+
+  uint8_t* p = pos;
+  size_t len = insn.length();
+  size_t count = std::min(accesses.size(), size_t(TRACE_ACCESS_ESCAPE));
+  uint8_t flags = count << TRACE_ACCESS_SHIFT;
+  if (pc != next_pc)
+    flags |= TRACE_PC_DELTA;
+  if (write.addr)
+    flags |= TRACE_REG_WRITE;
+  if (npc != pc + len)
+    flags |= TRACE_JUMP;
+  if (fetch_addr - pc != bias)
+    flags |= TRACE_FETCH_BIAS;
+
+  *p++ = flags;
+  if (flags & TRACE_PC_DELTA)
+    p = trace_put_varint(p, trace_zigzag(pc - last_pc));
+  if (flags & TRACE_FETCH_BIAS) {
+    bias = fetch_addr - pc;
+    p = trace_put_varint(p, trace_zigzag(bias));
+  }
+  for (size_t i = 0; i < len; i++)
+    *p++ = insn.bits() >> (8 * i);
+  if (flags & TRACE_REG_WRITE) {
+    unsigned reg = (write.addr >> 1) | (write.addr & 1 ? 32 : 0);
+    *p++ = reg;
+    p = trace_put_varint(p, trace_zigzag(write.data - regs[reg]));
+    regs[reg] = write.data;
+  }
+  if (flags & TRACE_JUMP)
+    p = trace_put_varint(p, trace_zigzag(npc - pc));
+  if (count == TRACE_ACCESS_ESCAPE)
+    p = trace_put_varint(p, accesses.size());
+  for (auto& a : accesses) {
+    *p++ = a.size | (a.store ? TRACE_ACCESS_STORE : 0);
+    p = trace_put_varint(p, trace_zigzag(a.addr - last_addr));
+    last_addr = a.addr;
+  }
+
+  last_pc = pc;
+  next_pc = npc;
+  records++;
+  cur.records++;
+  pos = p;
+  if (pos >= end)
+    flush_block();
+}
+
+void trace_writer_t::write_blocks()
+{
+  std::vector<std::pair<uint64_t, uint64_t>> index; // offset, first record
+  std::vector<uint8_t> packed, header;
+  uint64_t offset = 16, total = 0;
+
+  while (true) {
+    block_t b;
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      cond.wait(guard, [this]{ return done || !queue.empty(); });
+      if (queue.empty())
+        break;
+      b = std::move(queue.front());
+      queue.pop_front();
+    }
+    cond.notify_all();
+
+    packed.resize(tracez_bound(b.raw.size()));
+    packed.resize(tracez_compress(b.raw.data(), b.raw.size(), packed.data()));
+    header.clear();
+    put_le(header, b.raw.size(), 4);
+    put_le(header, packed.size(), 4);
+    put_le(header, b.records, 4);
+    put_le(header, 0, 4);
+    fwrite(header.data(), 1, header.size(), file);
+    fwrite(packed.data(), 1, packed.size(), file);
+
+    index.push_back(std::make_pair(offset, b.first_record));
+    offset += header.size() + packed.size();
+    total = b.first_record + b.records;
+  }
+
+  std::vector<uint8_t> tail;
+  for (auto& i : index) {
+    put_le(tail, i.first, 8);
+    put_le(tail, i.second, 8);
+  }
+  put_le(tail, index.size(), 8);
+  put_le(tail, total, 8);
+  put_le(tail, offset, 8);
+  tail.insert(tail.end(), TRACE_INDEX_MAGIC, TRACE_INDEX_MAGIC + 8);
+  fwrite(tail.data(), 1, tail.size(), file);
+}
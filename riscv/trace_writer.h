@@ -0,0 +1,79 @@
+// See LICENSE for license details.
+
+#ifndef _RISCV_TRACE_WRITER_H
+#define _RISCV_TRACE_WRITER_H
+
+#include "decode.h"
+#include "memtracer.h"
+#include "trace_file.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct commit_log_reg_t;
+
+// Writes one hart's retired instructions to a trace file (see trace_file.h).
+// The hart only encodes records into a block; a thread of the writer's own
+// compresses and writes full blocks, so tracing costs the hart little more
+// than the commit-log bookkeeping.  It is also an access tracer on the
+// hart's MMU (see mmu_t::register_access_tracer), and records the loads and
+// stores each instruction makes without taking them off the TLB.
+class trace_writer_t : public memtracer_t
+{
+ public:
+  trace_writer_t(const char* path);
+  // flushes the last block and writes the index
+  ~trace_writer_t();
+
+  bool interested_in_range(uint64_t begin, uint64_t end, access_type type)
+  {
+    return type != FETCH;
+  }
+  void trace(uint64_t addr, size_t bytes, access_type type)
+  {
+    accesses.push_back({addr, uint8_t(bytes), type == STORE});
+  }
+
+  // the hart is about to execute the instruction it fetched from fetch_addr
+  void begin(reg_t fetch_addr) { accesses.clear(); this->fetch_addr = fetch_addr; }
+  // and it retired, writing write (if write.addr is nonzero)
+  void retire(reg_t pc, insn_t insn, reg_t npc, const commit_log_reg_t& write);
+
+ private:
+  static const size_t BLOCK_SIZE = 256 * 1024;
+  static const size_t MAX_RECORD = 256; // not counting its accesses
+  static const size_t MAX_ACCESS = 11;
+  static const size_t MAX_QUEUED = 8;
+
+  struct block_t
+  {
+    std::vector<uint8_t> raw;
+    uint64_t first_record;
+    uint32_t records;
+  };
+
+  void start_block();
+  void flush_block();
+  void write_blocks(); // runs on the writer thread
+
+  FILE* file;
+  block_t cur;
+  uint8_t* pos;
+  uint8_t* end;
+
+  uint64_t records;
+  reg_t last_pc, next_pc, last_addr, bias;
+  reg_t fetch_addr;
+  reg_t regs[64];
+  std::vector<trace_access_t> accesses;
+
+  std::mutex lock;
+  std::condition_variable cond;
+  std::deque<block_t> queue;
+  bool done;
+  std::thread thread;
+};
+
+#endif
@@ -4,8 +4,68 @@
 #define _RISCV_TRACER_H
 
 #include "processor.h"
+#include "profiler.h"
+#include "branchpred.h"
 
-static inline void trace_opcode(processor_t* p, insn_bits_t opc, insn_t insn) {
+// Classify an instruction for the performance counters by its match bits.
+// Each handler passes a constant, so this folds away to at most one
+// increment per instruction.
+static inline hpm_event_t opcode_event(insn_bits_t opc) {
+  if ((opc & 3) != 3) {
+    unsigned quadrant = opc & 3, funct3 = (opc >> 13) & 7;
+    if (quadrant == 1)
+      return funct3 >= 6 ? HPM_BRANCH : HPM_NONE;
+    if (quadrant == 0 && funct3 >= 1 && funct3 <= 3)
+      return HPM_LOAD;
+    if (quadrant == 2 && funct3 >= 1 && funct3 <= 3)
+      return HPM_LOAD;
+    return funct3 >= 5 ? HPM_STORE : HPM_NONE;
+  }
+  switch (opc & 0x7f) {
+    case 0x03: case 0x07: return HPM_LOAD;
+    case 0x23: case 0x27: return HPM_STORE;
+    case 0x2f: return HPM_AMO;
+    case 0x63: return HPM_BRANCH;
+    case 0x33: case 0x3b:
+      if ((opc >> 25) != 1)
+        return HPM_NONE;
+      return ((opc >> 12) & 7) < 4 ? HPM_MUL : HPM_DIV;
+    case 0x43: case 0x47: case 0x4b: case 0x4f: return HPM_FP;
+    case 0x53:
+      // fdiv and fsqrt
+      if ((opc >> 27) == 0x03 || (opc >> 27) == 0x0b)
+        return HPM_FDIV;
+      return HPM_FP;
+    default: return HPM_NONE;
+  }
+}
+
+// Jumps that can link or return.  c.jal, c.jr and c.jalr share their
+// match bits with c.addiw, c.mv and c.add, which the profiler filters out.
+static inline bool opcode_is_jump(insn_bits_t opc) {
+  return opc == MATCH_JAL || opc == MATCH_JALR || opc == MATCH_C_JAL ||
+         opc == MATCH_C_JR || opc == MATCH_C_JALR;
+}
+
+// Everything a branch predictor sees: conditional branches and jumps.
+static inline bool opcode_is_branch(insn_bits_t opc) {
+  return opcode_event(opc) == HPM_BRANCH || opcode_is_jump(opc) ||
+         opc == MATCH_C_J;
+}
+
+// id is the dense index register_insn gave the handler
+static inline void trace_opcode(processor_t* p, insn_bits_t opc, insn_t insn,
+                                reg_t pc, reg_t npc, size_t id) {
+#ifdef RISCV_ENABLE_INSN_MIX
+  p->count_insn(id);
+#endif
+  hpm_event_t event = opcode_event(opc);
+  if (event != HPM_NONE)
+    p->count_event(event);
+  if (opcode_is_jump(opc) && unlikely(p->get_profiler() != NULL))
+    p->get_profiler()->jump(p, opc, insn, pc, npc);
+  if (opcode_is_branch(opc) && unlikely(p->get_branch_tracer() != NULL))
+    trace_branch(p, opc, insn, pc, npc);
 }
 
 #endif
@@ -0,0 +1,353 @@
+// See LICENSE for license details.
+
+#ifndef _RISCV_VECTOR_H
+#define _RISCV_VECTOR_H
+
+// Helpers for the vector instructions in insns/v*.h.  Integer arithmetic
+// works a whole register at a time on GCC vector types, which become host
+// SIMD instructions; a register is written back element by element only
+// when the instruction is masked or the register holds vstart or vl.  Tail
+// and masked-off elements are always left undisturbed, which the agnostic
+// policies allow too.  Floating-point elements go through hostfp.h one at a
+// time so that the flags come out as RISC-V's.
+
+#include "decode.h"
+#include "mmu.h"
+#include "hostfp.h"
+#include <algorithm>
+#include <cstring>
+
+template<class T>
+static inline T* vreg(state_t& s, reg_t reg)
+{
+  return (T*)&s.VR[reg * VLENB];
+}
+
+static inline bool vector_mask_bit(state_t& s, reg_t reg, reg_t i)
+{
+  return (s.VR[reg * VLENB + i / 8] >> (i % 8)) & 1;
+}
+
+static inline void vector_set_mask_bit(state_t& s, reg_t reg, reg_t i, bool bit)
+{
+  uint8_t& byte = s.VR[reg * VLENB + i / 8];
+  byte = (byte & ~(1 << (i % 8))) | (bit << (i % 8));
+}
+
+// whether element i is written: in [vstart, vl) and enabled by v0
+static inline bool vector_active(state_t& s, insn_t insn, reg_t i)
+{
+  return i >= s.vstart && i < s.vl && (insn.v_vm() || vector_mask_bit(s, 0, i));
+}
+
+static inline int vector_log2(reg_t x)
+{
+  return __builtin_ctzll(x);
+}
+
+// vsetvl, vsetvli and vsetivli: the new vl, from the requested one
+// (avl), the new vtype and whether rs1 and rd were both x0
+static inline reg_t vector_set_vl(state_t& s, int xlen, reg_t avl, reg_t vtype,
+                                  bool keep_vl)
+{
+  reg_t vsew = (vtype >> 3) & 7;
+  reg_t vlmul = vtype & 7;
+  int lmul = vlmul & 4 ? int(vlmul) - 8 : int(vlmul);
+  bool vill = vsew > 3 || vlmul == 4 || (vtype >> 8) != 0 ||
+              (lmul < 0 && (8 << vsew) > (ELEN >> -lmul));
+  reg_t vlmax = lmul >= 0 ? (VLENB << lmul) >> vsew : (VLENB >> -lmul) >> vsew;
+
+  // keeping vl is only allowed when VLMAX doesn't change
+  if (vill || (keep_vl && (s.vill || vlmax != s.vlmax))) {
+    s.vill = true;
+    s.vtype = reg_t(1) << (xlen - 1);
+    s.vl = 0;
+    s.vlmax = 0;
+  } else {
+    s.vill = false;
+    s.vtype = vtype;
+    s.vsew = reg_t(1) << vsew;
+    s.vlmul = lmul;
+    s.vlmax = vlmax;
+    s.vl = keep_vl ? s.vl : std::min(avl, vlmax);
+  }
+  s.vstart = 0;
+  return s.vl;
+}
+
+#define require_vector \
+  do { require(p->supports_vector()); require(!STATE.vill); } while (0)
+// a group of 2^lmul registers starts at a multiple of its size
+#define require_vreg(reg, lmul) \
+  require((lmul) <= 0 || ((reg) & ((1 << (lmul)) - 1)) == 0)
+// a masked instruction can't write v0, which holds the mask
+#define require_vm_ok require(insn.v_vm() || insn.rd() != 0)
+
+#define VI_TYPES(bits) \
+  typedef uint##bits##_t u_t; \
+  typedef int##bits##_t s_t; \
+  typedef u_t u_v __attribute__((vector_size(VLENB))); \
+  typedef s_t s_v __attribute__((vector_size(VLENB)));
+
+#define VI_SEW_SWITCH(...) \
+  switch (STATE.vsew) { \
+    case 1: { VI_TYPES(8) __VA_ARGS__ } break; \
+    case 2: { VI_TYPES(16) __VA_ARGS__ } break; \
+    case 4: { VI_TYPES(32) __VA_ARGS__ } break; \
+    default: { VI_TYPES(64) __VA_ARGS__ } break; \
+  }
+
+// vd = BODY on vd, vs2 and vs1, a register of each at a time.  K is u for
+// unsigned elements and s for signed ones; SRC1 is vs1's register j
+// (vs1_p[j]) or a scalar, which is splatted.
+#define VI_LOOP(K, SRC1, BODY) \
+  VI_SEW_SWITCH( \
+    K##_v* vd_p = vreg<K##_v>(STATE, insn.rd()); \
+    K##_v* vs1_p = vreg<K##_v>(STATE, insn.rs1()); \
+    K##_v* vs2_p = vreg<K##_v>(STATE, insn.rs2()); \
+    const reg_t lanes = VLENB / sizeof(K##_t); \
+    for (reg_t j = STATE.vstart / lanes; j * lanes < STATE.vl; j++) { \
+      K##_v vs1 = SRC1, vs2 = vs2_p[j], vd = vd_p[j]; \
+      BODY; \
+      reg_t first = j * lanes; \
+      if (insn.v_vm() && first >= STATE.vstart && first + lanes <= STATE.vl) { \
+        vd_p[j] = vd; \
+      } else { \
+        for (reg_t k = 0; k < lanes; k++) \
+          if (vector_active(STATE, insn, first + k)) \
+            vd_p[j][k] = vd[k]; \
+      } \
+    } \
+  ) \
+  STATE.vstart = 0;
+
+#define VI_SPLAT(K, x) (K##_v{} + (K##_t)(x))
+
+#define VI_CHECK_VV \
+  require_vector; \
+  require_vm_ok; \
+  require_vreg(insn.rd(), STATE.vlmul); \
+  require_vreg(insn.rs1(), STATE.vlmul); \
+  require_vreg(insn.rs2(), STATE.vlmul)
+#define VI_CHECK_VX \
+  require_vector; \
+  require_vm_ok; \
+  require_vreg(insn.rd(), STATE.vlmul); \
+  require_vreg(insn.rs2(), STATE.vlmul)
+
+#define VI_VV(K, BODY) VI_CHECK_VV; VI_LOOP(K, vs1_p[j], BODY)
+#define VI_VX(K, BODY) VI_CHECK_VX; VI_LOOP(K, VI_SPLAT(K, RS1), BODY)
+#define VI_VI(K, BODY) VI_CHECK_VX; VI_LOOP(K, VI_SPLAT(K, insn.v_simm5()), BODY)
+// shifts take an unsigned immediate
+#define VI_VIU(K, BODY) VI_CHECK_VX; VI_LOOP(K, VI_SPLAT(K, insn.rs1()), BODY)
+
+// the shift amount in vs1: its low log2(SEW) bits
+#define VI_SHAMT(K) (vs1 & (K##_t)(sizeof(K##_t) * 8 - 1))
+
+// compares, which write a mask bit for each element to vd
+#define VI_CMP_LOOP(K, SRC1, COND) \
+  VI_SEW_SWITCH( \
+    K##_v* vs1_p = vreg<K##_v>(STATE, insn.rs1()); \
+    K##_v* vs2_p = vreg<K##_v>(STATE, insn.rs2()); \
+    const reg_t lanes = VLENB / sizeof(K##_t); \
+    for (reg_t j = STATE.vstart / lanes; j * lanes < STATE.vl; j++) { \
+      K##_v vs1 = SRC1, vs2 = vs2_p[j]; \
+      auto res = COND; \
+      for (reg_t k = 0; k < lanes; k++) \
+        if (vector_active(STATE, insn, j * lanes + k)) \
+          vector_set_mask_bit(STATE, insn.rd(), j * lanes + k, res[k] != 0); \
+    } \
+  ) \
+  STATE.vstart = 0;
+
+#define VI_CMP_CHECK(vv) \
+  require_vector; \
+  require_vreg(insn.rs2(), STATE.vlmul); \
+  if (vv) require_vreg(insn.rs1(), STATE.vlmul)
+
+#define VI_CMP_VV(K, COND) VI_CMP_CHECK(true); VI_CMP_LOOP(K, vs1_p[j], COND)
+#define VI_CMP_VX(K, COND) VI_CMP_CHECK(false); VI_CMP_LOOP(K, VI_SPLAT(K, RS1), COND)
+#define VI_CMP_VI(K, COND) VI_CMP_CHECK(false); VI_CMP_LOOP(K, VI_SPLAT(K, insn.v_simm5()), COND)
+
+// vmerge: vd = v0 ? vs1 : vs2 for every element in [vstart, vl)
+#define VI_MERGE(SRC1) \
+  require_vector; \
+  require(insn.rd() != 0); \
+  require_vreg(insn.rd(), STATE.vlmul); \
+  require_vreg(insn.rs2(), STATE.vlmul); \
+  VI_SEW_SWITCH( \
+    u_t* vd = vreg<u_t>(STATE, insn.rd()); \
+    u_t* vs1_p = vreg<u_t>(STATE, insn.rs1()); \
+    u_t* vs2 = vreg<u_t>(STATE, insn.rs2()); \
+    for (reg_t i = STATE.vstart; i < STATE.vl; i++) \
+      vd[i] = vector_mask_bit(STATE, 0, i) ? (u_t)(SRC1) : vs2[i]; \
+  ) \
+  STATE.vstart = 0;
+
+// vd[0] = vs1[0] + the sum of the active elements of vs2
+#define VI_REDSUM \
+  require_vector; \
+  require(STATE.vstart == 0); \
+  require_vreg(insn.rs2(), STATE.vlmul); \
+  if (STATE.vl) { \
+    VI_SEW_SWITCH( \
+      u_v* vs2_p = vreg<u_v>(STATE, insn.rs2()); \
+      const reg_t lanes = VLENB / sizeof(u_t); \
+      u_v accv = {}; \
+      u_t acc = vreg<u_t>(STATE, insn.rs1())[0]; \
+      for (reg_t j = 0; j * lanes < STATE.vl; j++) { \
+        if (insn.v_vm() && (j + 1) * lanes <= STATE.vl) { \
+          accv += vs2_p[j]; \
+        } else { \
+          for (reg_t k = 0; k < lanes; k++) \
+            if (vector_active(STATE, insn, j * lanes + k)) \
+              acc += vs2_p[j][k]; \
+        } \
+      } \
+      for (reg_t k = 0; k < lanes; k++) \
+        acc += accv[k]; \
+      vreg<u_t>(STATE, insn.rd())[0] = acc; \
+    ) \
+  }
+
+// floating point, with SEW 32 or 64
+#define VF_CHECK \
+  require_vector; \
+  require_fp; \
+  require(STATE.vsew == 4 ? p->supports_extension('F') : \
+          STATE.vsew == 8 && p->supports_extension('D'))
+
+#define VF_LOOP(SRC1, BODY) \
+  require(STATE.frm <= 4); \
+  softfloat_roundingMode = STATE.frm; \
+  switch (STATE.vsew) { \
+    case 4: { VF_ELEMENTS(float32_t, uint32_t, SRC1, BODY) } break; \
+    default: { VF_ELEMENTS(float64_t, uint64_t, SRC1, BODY) } break; \
+  } \
+  STATE.vstart = 0; \
+  set_fp_exceptions;
+
+#define VF_ELEMENTS(F, U, SRC1, BODY) \
+  U* vd_p = vreg<U>(STATE, insn.rd()); \
+  U* vs1_p = vreg<U>(STATE, insn.rs1()); \
+  U* vs2_p = vreg<U>(STATE, insn.rs2()); \
+  for (reg_t i = STATE.vstart; i < STATE.vl; i++) { \
+    if (!vector_active(STATE, insn, i)) \
+      continue; \
+    uint64_t fflags = STATE.fflags | softfloat_exceptionFlags; \
+    F vs1 = {(U)(SRC1)}, vs2 = {vs2_p[i]}, vd = {vd_p[i]}; \
+    BODY; \
+    vd_p[i] = vd.v; \
+  }
+
+#define VF_VV(BODY) VI_CHECK_VV; VF_CHECK; VF_LOOP(vs1_p[i], BODY)
+#define VF_VF(BODY) VI_CHECK_VX; VF_CHECK; VF_LOOP(FRS1, BODY)
+
+static inline float32_t vfp_add(uint64_t f, float32_t a, float32_t b) { return hostfp_f32_add(f, a, b); }
+static inline float64_t vfp_add(uint64_t f, float64_t a, float64_t b) { return hostfp_f64_add(f, a, b); }
+static inline float32_t vfp_sub(uint64_t f, float32_t a, float32_t b) { return hostfp_f32_sub(f, a, b); }
+static inline float64_t vfp_sub(uint64_t f, float64_t a, float64_t b) { return hostfp_f64_sub(f, a, b); }
+static inline float32_t vfp_mul(uint64_t f, float32_t a, float32_t b) { return hostfp_f32_mul(f, a, b); }
+static inline float64_t vfp_mul(uint64_t f, float64_t a, float64_t b) { return hostfp_f64_mul(f, a, b); }
+static inline float32_t vfp_div(uint64_t f, float32_t a, float32_t b) { return hostfp_f32_div(f, a, b); }
+static inline float64_t vfp_div(uint64_t f, float64_t a, float64_t b) { return hostfp_f64_div(f, a, b); }
+static inline float32_t vfp_mulAdd(uint64_t f, float32_t a, float32_t b, float32_t c) { return hostfp_f32_mulAdd(f, a, b, c); }
+static inline float64_t vfp_mulAdd(uint64_t f, float64_t a, float64_t b, float64_t c) { return hostfp_f64_mulAdd(f, a, b, c); }
+
+// loads and stores of elements of type T
+static inline void vector_access(mmu_t& mmu, reg_t addr, uint8_t& x, bool store)
+{
+  if (store) mmu.store_uint8(addr, x); else x = mmu.load_uint8(addr);
+}
+static inline void vector_access(mmu_t& mmu, reg_t addr, uint16_t& x, bool store)
+{
+  if (store) mmu.store_uint16(addr, x); else x = mmu.load_uint16(addr);
+}
+static inline void vector_access(mmu_t& mmu, reg_t addr, uint32_t& x, bool store)
+{
+  if (store) mmu.store_uint32(addr, x); else x = mmu.load_uint32(addr);
+}
+static inline void vector_access(mmu_t& mmu, reg_t addr, uint64_t& x, bool store)
+{
+  if (store) mmu.store_uint64(addr, x); else x = mmu.load_uint64(addr);
+}
+
+// element i of register group vd (or vs3) at base + i * stride.  Unmasked
+// unit-stride runs within a page the TLB holds are copied with memcpy.
+// vstart follows the elements so that a fault leaves it at the one that
+// faulted.
+template<class T>
+static void vector_strided(processor_t* p, insn_t insn, reg_t base,
+                           reg_t stride, bool store)
+{
+  state_t& s = *p->get_state();
+  mmu_t& mmu = *p->get_mmu();
+  T* vd = vreg<T>(s, insn.rd());
+  reg_t i = s.vstart;
+
+  if (stride == sizeof(T) && insn.v_vm() && base % sizeof(T) == 0) {
+    while (i < s.vl) {
+      reg_t addr = base + i * sizeof(T);
+      reg_t n = std::min(s.vl - i, (PGSIZE - addr % PGSIZE) / sizeof(T));
+      if (char* host = store ? mmu.tlb_store_ptr(addr, n * sizeof(T))
+                             : mmu.tlb_load_ptr(addr, n * sizeof(T))) {
+        if (store)
+          memcpy(host, &vd[i], n * sizeof(T));
+        else
+          memcpy(&vd[i], host, n * sizeof(T));
+        i += n;
+      } else {
+        // the slow path fills the TLB for the rest of the page
+        s.vstart = i;
+        vector_access(mmu, addr, vd[i], store);
+        i++;
+      }
+    }
+  }
+
+  for (; i < s.vl; i++) {
+    if (!vector_active(s, insn, i))
+      continue;
+    s.vstart = i;
+    vector_access(mmu, base + i * stride, vd[i], store);
+  }
+  s.vstart = 0;
+}
+
+// element i of vd (or vs3) at base + the i-th I-sized offset in vs2
+template<class T, class I>
+static void vector_indexed(processor_t* p, insn_t insn, reg_t base, bool store)
+{
+  state_t& s = *p->get_state();
+  mmu_t& mmu = *p->get_mmu();
+  T* vd = vreg<T>(s, insn.rd());
+  I* index = vreg<I>(s, insn.rs2());
+  for (reg_t i = s.vstart; i < s.vl; i++) {
+    if (!vector_active(s, insn, i))
+      continue;
+    s.vstart = i;
+    vector_access(mmu, base + index[i], vd[i], store);
+  }
+  s.vstart = 0;
+}
+
+// EMUL for elements of type T
+#define VMEM_EMUL(T) \
+  (vector_log2(sizeof(T)) - vector_log2(STATE.vsew) + STATE.vlmul)
+
+#define VMEM_STRIDED(T, STRIDE, STORE) \
+  require_vector; \
+  require(VMEM_EMUL(T) >= -3 && VMEM_EMUL(T) <= 3); \
+  require_vreg(insn.rd(), VMEM_EMUL(T)); \
+  if (!(STORE)) require_vm_ok; \
+  vector_strided<T>(p, insn, RS1, STRIDE, STORE);
+
+#define VMEM_INDEXED(I, STORE) \
+  require_vector; \
+  require(VMEM_EMUL(I) >= -3 && VMEM_EMUL(I) <= 3); \
+  require_vreg(insn.rd(), STATE.vlmul); \
+  require_vreg(insn.rs2(), VMEM_EMUL(I)); \
+  if (!(STORE)) require_vm_ok; \
+  VI_SEW_SWITCH(vector_indexed<u_t, I>(p, insn, RS1, STORE);)
+
+#endif
@@ -55,6 +55,22 @@ extern "C" {
 
 #include "softfloat_types.h"
 
+/*----------------------------------------------------------------------------
+| The rounding mode and exception flags belong to the calling thread, so
+| simulations on different threads don't see each other's.  Each hart's
+| instructions set the rounding mode before every operation and move the
+| flags into its fflags after it, so between instructions this state is
+| always the same and a thread can run any number of harts.  The compiler
+| picks the TLS model: built into an executable, an access is a single
+| %fs-relative load or store; built into libsoftfloat.so, it goes through a
+| TLS descriptor where configure found them.  Forcing initial-exec here
+| would be as fast, but then a program that dlopen()s the library can fail
+| to load it once glibc's spare static TLS is used up.
+*----------------------------------------------------------------------------*/
+#ifndef THREAD_LOCAL
+#define THREAD_LOCAL __thread
+#endif
+
 /*----------------------------------------------------------------------------
 | Software floating-point underflow tininess-detection mode.
 *----------------------------------------------------------------------------*/
@@ -67,7 +83,7 @@ enum {
 /*----------------------------------------------------------------------------
 | Software floating-point rounding mode.
 *----------------------------------------------------------------------------*/
-extern uint_fast8_t softfloat_roundingMode;
+extern THREAD_LOCAL uint_fast8_t softfloat_roundingMode;
 enum {
     softfloat_round_near_even   = 0,
     softfloat_round_minMag      = 1,
@@ -79,7 +95,7 @@ enum {
 /*----------------------------------------------------------------------------
 | Software floating-point exception flags.
 *----------------------------------------------------------------------------*/
-extern uint_fast8_t softfloat_exceptionFlags;
+extern THREAD_LOCAL uint_fast8_t softfloat_exceptionFlags;
 enum {
     softfloat_flag_inexact   =  1,
     softfloat_flag_underflow =  2,
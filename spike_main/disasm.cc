@@ -248,6 +248,63 @@ struct : public arg_t {
   }
 } rvc_jump_target;
 
+struct : public arg_t {
+  std::string to_string(insn_t insn) const {
+    return vpr_name[insn.rd()];
+  }
+} vd;
+
+struct : public arg_t {
+  std::string to_string(insn_t insn) const {
+    return vpr_name[insn.rs1()];
+  }
+} vs1;
+
+struct : public arg_t {
+  std::string to_string(insn_t insn) const {
+    return vpr_name[insn.rs2()];
+  }
+} vs2;
+
+struct : public arg_t {
+  std::string to_string(insn_t insn) const {
+    return vpr_name[0];
+  }
+} vzero;
+
+struct : public arg_t {
+  std::string to_string(insn_t insn) const {
+    return std::string(vpr_name[0]) + ".t";
+  }
+} vmask;
+
+struct : public arg_t {
+  std::string to_string(insn_t insn) const {
+    return std::string("(") + xpr_name[insn.rs1()] + ')';
+  }
+} v_address;
+
+struct : public arg_t {
+  std::string to_string(insn_t insn) const {
+    return std::to_string((int)insn.v_simm5());
+  }
+} vsimm5;
+
+struct : public arg_t {
+  std::string to_string(insn_t insn) const {
+    // vsetivli has one bit fewer for vtype than vsetvli
+    reg_t vtype = insn.bits() & 0x80000000 ? insn.v_zimm10() : insn.v_zimm11();
+    static const char* lmul[8] = {"m1", "m2", "m4", "m8", 0, "mf8", "mf4", "mf2"};
+    if ((vtype >> 8) || ((vtype >> 3) & 7) > 3 || !lmul[vtype & 7]) {
+      std::stringstream s;
+      s << std::hex << "0x" << vtype;
+      return s.str();
+    }
+    return "e" + std::to_string(8 << ((vtype >> 3) & 7)) + "," + lmul[vtype & 7] +
+           (vtype & 0x40 ? ",ta" : ",tu") + (vtype & 0x80 ? ",ma" : ",mu");
+  }
+} vtypei;
+
 std::string disassembler_t::disassemble(insn_t insn) const
 {
   const disasm_insn_t* disasm_insn = lookup(insn);
@@ -265,6 +322,7 @@ disassembler_t::disassembler_t(int xlen)
   const uint32_t match_imm_1 = 1UL << 20;
   const uint32_t mask_rvc_rs2 = 0x1fUL << 2;
   const uint32_t mask_rvc_imm = mask_rvc_rs2 | 0x1000UL;
+  const uint32_t mask_vm = 1UL << 25;
 
   #define DECLARE_INSN(code, match, mask) \
    const uint32_t match_##code = match; \
@@ -296,6 +354,10 @@ disassembler_t::disassembler_t(int xlen)
   #define DEFINE_FR3TYPE(code) DISASM_INSN(#code, code, 0, {&frd, &frs1, &frs2, &frs3})
   #define DEFINE_FXTYPE(code) DISASM_INSN(#code, code, 0, {&xrd, &frs1})
   #define DEFINE_XFTYPE(code) DISASM_INSN(#code, code, 0, {&frd, &xrs1})
+  // vector instructions, with v0.t when masked
+  #define DEFINE_VTYPE(code, ...) \
+    DISASM_INSN(#code, code, mask_vm, {__VA_ARGS__, &vmask}) \
+    add_insn(new disasm_insn_t(#code, match_##code | mask_vm, mask_##code | mask_vm, {__VA_ARGS__}));
 
   DEFINE_XLOAD(lb)
   DEFINE_XLOAD(lbu)
@@ -499,6 +561,122 @@ disassembler_t::disassembler_t(int xlen)
   DEFINE_FXTYPE(flt_d);
   DEFINE_FXTYPE(fle_d);
 
+  DISASM_INSN("vsetvli", vsetvli, 0, {&xrd, &xrs1, &vtypei});
+  DISASM_INSN("vsetivli", vsetivli, 0, {&xrd, &zimm5, &vtypei});
+  DISASM_INSN("vsetvl", vsetvl, 0, {&xrd, &xrs1, &xrs2});
+  DEFINE_VTYPE(vle8_v, &vd, &v_address)
+  DEFINE_VTYPE(vlse8_v, &vd, &v_address, &xrs2)
+  DEFINE_VTYPE(vluxei8_v, &vd, &v_address, &vs2)
+  DEFINE_VTYPE(vloxei8_v, &vd, &v_address, &vs2)
+  DEFINE_VTYPE(vse8_v, &vd, &v_address)
+  DEFINE_VTYPE(vsse8_v, &vd, &v_address, &xrs2)
+  DEFINE_VTYPE(vsuxei8_v, &vd, &v_address, &vs2)
+  DEFINE_VTYPE(vsoxei8_v, &vd, &v_address, &vs2)
+  DEFINE_VTYPE(vle16_v, &vd, &v_address)
+  DEFINE_VTYPE(vlse16_v, &vd, &v_address, &xrs2)
+  DEFINE_VTYPE(vluxei16_v, &vd, &v_address, &vs2)
+  DEFINE_VTYPE(vloxei16_v, &vd, &v_address, &vs2)
+  DEFINE_VTYPE(vse16_v, &vd, &v_address)
+  DEFINE_VTYPE(vsse16_v, &vd, &v_address, &xrs2)
+  DEFINE_VTYPE(vsuxei16_v, &vd, &v_address, &vs2)
+  DEFINE_VTYPE(vsoxei16_v, &vd, &v_address, &vs2)
+  DEFINE_VTYPE(vle32_v, &vd, &v_address)
+  DEFINE_VTYPE(vlse32_v, &vd, &v_address, &xrs2)
+  DEFINE_VTYPE(vluxei32_v, &vd, &v_address, &vs2)
+  DEFINE_VTYPE(vloxei32_v, &vd, &v_address, &vs2)
+  DEFINE_VTYPE(vse32_v, &vd, &v_address)
+  DEFINE_VTYPE(vsse32_v, &vd, &v_address, &xrs2)
+  DEFINE_VTYPE(vsuxei32_v, &vd, &v_address, &vs2)
+  DEFINE_VTYPE(vsoxei32_v, &vd, &v_address, &vs2)
+  DEFINE_VTYPE(vle64_v, &vd, &v_address)
+  DEFINE_VTYPE(vlse64_v, &vd, &v_address, &xrs2)
+  DEFINE_VTYPE(vluxei64_v, &vd, &v_address, &vs2)
+  DEFINE_VTYPE(vloxei64_v, &vd, &v_address, &vs2)
+  DEFINE_VTYPE(vse64_v, &vd, &v_address)
+  DEFINE_VTYPE(vsse64_v, &vd, &v_address, &xrs2)
+  DEFINE_VTYPE(vsuxei64_v, &vd, &v_address, &vs2)
+  DEFINE_VTYPE(vsoxei64_v, &vd, &v_address, &vs2)
+  DEFINE_VTYPE(vadd_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vadd_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vadd_vi, &vd, &vs2, &vsimm5)
+  DEFINE_VTYPE(vsub_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vsub_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vrsub_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vrsub_vi, &vd, &vs2, &vsimm5)
+  DEFINE_VTYPE(vminu_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vminu_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vmin_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vmin_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vmaxu_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vmaxu_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vmax_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vmax_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vand_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vand_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vand_vi, &vd, &vs2, &vsimm5)
+  DEFINE_VTYPE(vor_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vor_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vor_vi, &vd, &vs2, &vsimm5)
+  DEFINE_VTYPE(vxor_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vxor_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vxor_vi, &vd, &vs2, &vsimm5)
+  DEFINE_VTYPE(vsll_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vsll_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vsll_vi, &vd, &vs2, &zimm5)
+  DEFINE_VTYPE(vsrl_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vsrl_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vsrl_vi, &vd, &vs2, &zimm5)
+  DEFINE_VTYPE(vsra_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vsra_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vsra_vi, &vd, &vs2, &zimm5)
+  DEFINE_VTYPE(vmseq_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vmseq_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vmseq_vi, &vd, &vs2, &vsimm5)
+  DEFINE_VTYPE(vmsne_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vmsne_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vmsne_vi, &vd, &vs2, &vsimm5)
+  DEFINE_VTYPE(vmsltu_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vmsltu_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vmslt_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vmslt_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vmsleu_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vmsleu_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vmsleu_vi, &vd, &vs2, &vsimm5)
+  DEFINE_VTYPE(vmsle_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vmsle_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vmsle_vi, &vd, &vs2, &vsimm5)
+  DEFINE_VTYPE(vmsgtu_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vmsgtu_vi, &vd, &vs2, &vsimm5)
+  DEFINE_VTYPE(vmsgt_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vmsgt_vi, &vd, &vs2, &vsimm5)
+  DISASM_INSN("vmerge.vvm", vmerge_vvm, 0, {&vd, &vs2, &vs1, &vzero});
+  DISASM_INSN("vmerge.vxm", vmerge_vxm, 0, {&vd, &vs2, &xrs1, &vzero});
+  DISASM_INSN("vmerge.vim", vmerge_vim, 0, {&vd, &vs2, &vsimm5, &vzero});
+  DISASM_INSN("vmv.v.v", vmv_v_v, 0, {&vd, &vs1});
+  DISASM_INSN("vmv.v.x", vmv_v_x, 0, {&vd, &xrs1});
+  DISASM_INSN("vmv.v.i", vmv_v_i, 0, {&vd, &vsimm5});
+  DEFINE_VTYPE(vredsum_vs, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vmul_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vmul_vx, &vd, &vs2, &xrs1)
+  DEFINE_VTYPE(vmacc_vv, &vd, &vs1, &vs2)
+  DEFINE_VTYPE(vmacc_vx, &vd, &xrs1, &vs2)
+  DISASM_INSN("vmv.x.s", vmv_x_s, 0, {&xrd, &vs2});
+  DISASM_INSN("vmv.s.x", vmv_s_x, 0, {&vd, &xrs1});
+  DEFINE_VTYPE(vfadd_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vfadd_vf, &vd, &vs2, &frs1)
+  DEFINE_VTYPE(vfsub_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vfsub_vf, &vd, &vs2, &frs1)
+  DEFINE_VTYPE(vfmul_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vfmul_vf, &vd, &vs2, &frs1)
+  DEFINE_VTYPE(vfdiv_vv, &vd, &vs2, &vs1)
+  DEFINE_VTYPE(vfdiv_vf, &vd, &vs2, &frs1)
+  DEFINE_VTYPE(vfmacc_vv, &vd, &vs1, &vs2)
+  DEFINE_VTYPE(vfmacc_vf, &vd, &frs1, &vs2)
+  DISASM_INSN("vfmv.f.s", vfmv_f_s, 0, {&frd, &vs2});
+  DISASM_INSN("vfmv.s.f", vfmv_s_f, 0, {&vd, &frs1});
+  DISASM_INSN("vfmv.v.f", vfmv_v_f, 0, {&vd, &frs1});
+
+
   DISASM_INSN("ebreak", c_add, mask_rd | mask_rvc_rs2, {});
   add_insn(new disasm_insn_t("ret", match_c_li | match_rd_ra, mask_c_li | mask_rd | mask_rvc_imm, {}));
   DISASM_INSN("jr", c_li, mask_rvc_imm, {&rvc_rs1});
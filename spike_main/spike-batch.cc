@@ -0,0 +1,275 @@
+// See LICENSE for license details.
+
+// This program runs many small test programs, such as the riscv-tests, in
+// one process: each gets a machine of its own, built through libspike.h,
+// and the machines run on a pool of threads.  A program finishes when it
+// writes an exit code to tohost, as under spike; its console output,
+// through the syscall or character device, is kept and printed with its
+// result.
+
+#include "libspike.h"
+#include "elf_program.h"
+#include "thread_pool.h"
+#include "config.h"
+#include "encoding.h"
+#include <fesvr/option_parser.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <cinttypes>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static void help()
+{
+  fprintf(stderr, "usage: spike-batch [options] <program>...\n");
+  fprintf(stderr, "Options:\n");
+  fprintf(stderr, "  -p<n>                 Simulate <n> processors [default 1]\n");
+  fprintf(stderr, "  -m<n>                 Provide <n> MiB of target memory [default 64]\n");
+  fprintf(stderr, "  --isa=<name>          RISC-V ISA string [default %s]\n", DEFAULT_ISA);
+  fprintf(stderr, "  --max-insns=<n>       Fail a program after <n> instructions\n");
+  fprintf(stderr, "                          [default 100000000]\n");
+  fprintf(stderr, "  -j<n>                 Use <n> threads [default one per CPU]\n");
+  fprintf(stderr, "  -v                    Print every program's output, not just failures'\n");
+  fprintf(stderr, "  -h                    Print this help message\n");
+  exit(1);
+}
+
+// instructions between looks at tohost
+static const size_t QUANTUM = 5000;
+
+static volatile sig_atomic_t interrupted = 0;
+static void handle_signal(int sig)
+{
+  if (interrupted)
+    exit(-1);
+  interrupted = 1;
+  signal(sig, &handle_signal);
+}
+
+struct job_t
+{
+  const char* path;
+  std::shared_ptr<const elf_program_t> program;
+
+  enum { PENDING, PASS, FAIL, TIMEOUT, INTERRUPTED, ERROR } result;
+  uint64_t exit_code;
+  uint64_t instret;
+  std::string output;
+  std::string error;
+};
+
+static uint64_t read_u64(spike_t* s, uint64_t addr)
+{
+  uint64_t x = 0;
+  spike_read_mem(s, addr, 8, &x);
+  return x;
+}
+
+static void write_u64(spike_t* s, uint64_t addr, uint64_t x)
+{
+  spike_write_mem(s, addr, 8, &x);
+}
+
+// answer a request the target made through tohost, as fesvr's syscall
+// proxy and character device would; true if it asked to exit
+static bool serve(spike_t* s, job_t& job, uint64_t tohost)
+{
+  uint64_t dev = tohost >> 56, cmd = (tohost >> 48) & 0xff;
+  uint64_t payload = tohost << 16 >> 16;
+  uint64_t response;
+
+  if (dev == 0 && cmd == 0 && (payload & 1)) {
+    job.exit_code = payload >> 1;
+    return true;
+  } else if (dev == 0 && cmd == 0) {
+    // payload points to the syscall number and its arguments
+    uint64_t args[4];
+    if (spike_read_mem(s, payload, sizeof(args), args) != 0)
+      return false;
+    int64_t ret = -38; // ENOSYS
+    if (args[0] == 64 && (args[1] == 1 || args[1] == 2)) { // write(stdout/err)
+      // the length is the target's; copy in chunks so a bad one just
+      // runs off the end of memory
+      std::string buf;
+      char chunk[4096];
+      ret = 0;
+      for (uint64_t done = 0; done < args[3]; done += sizeof(chunk)) {
+        size_t len = std::min<uint64_t>(args[3] - done, sizeof(chunk));
+        if (spike_read_mem(s, args[2] + done, len, chunk) != 0) {
+          ret = -14; // EFAULT
+          break;
+        }
+        buf.append(chunk, len);
+      }
+      if (ret == 0) {
+        job.output += buf;
+        ret = buf.size();
+      }
+    }
+    write_u64(s, payload, ret);
+    response = 1;
+  } else if (dev == 1 && cmd == 1) {
+    job.output += char(payload);
+    response = 0x100 | uint8_t(payload);
+  } else {
+    return false;
+  }
+
+  if (job.program->fromhost)
+    write_u64(s, job.program->fromhost, (dev << 56) | (cmd << 48) | response);
+  return false;
+}
+
+static void run_job(job_t& job, const char* isa, size_t nprocs, size_t mem_mb,
+                    uint64_t max_insns)
+{
+  if (interrupted) {
+    job.result = job_t::INTERRUPTED;
+    return;
+  }
+  if (!job.program->error.empty()) {
+    job.result = job_t::ERROR;
+    job.error = job.program->error;
+    return;
+  }
+
+  std::unique_ptr<spike_t, void(*)(spike_t*)> s(spike_new(isa, nprocs, mem_mb), &spike_delete);
+  if (!s) {
+    job.result = job_t::ERROR;
+    job.error = "bad --isa option";
+    return;
+  }
+  const elf_program_t& p = *job.program;
+  for (auto& seg : p.segments) {
+    if (spike_write_mem(&*s, seg.addr, seg.size, &p.image[seg.offset]) != 0) {
+      job.result = job_t::ERROR;
+      job.error = "segment outside memory";
+      return;
+    }
+  }
+
+  job.result = job_t::TIMEOUT;
+  for (uint64_t insns = 0; insns < max_insns; insns += QUANTUM) {
+    if (interrupted) {
+      job.result = job_t::INTERRUPTED;
+      break;
+    }
+    if (spike_step(&*s, QUANTUM) != 0) {
+      job.result = job_t::ERROR;
+      job.error = "simulator error";
+      break;
+    }
+    uint64_t tohost = read_u64(&*s, p.tohost);
+    if (tohost) {
+      write_u64(&*s, p.tohost, 0);
+      if (serve(&*s, job, tohost)) {
+        job.result = job.exit_code == 0 ? job_t::PASS : job_t::FAIL;
+        break;
+      }
+    }
+  }
+
+  job.instret = 0;
+  for (size_t i = 0; i < nprocs; i++) {
+    uint64_t instret;
+    if (spike_get_csr(&*s, i, CSR_MINSTRET, &instret) == 0)
+      job.instret += instret;
+  }
+}
+
+// one job's failure mustn't take down the pool running the others
+static void run(job_t& job, const char* isa, size_t nprocs, size_t mem_mb,
+                uint64_t max_insns)
+{
+  try {
+    run_job(job, isa, nprocs, mem_mb, max_insns);
+  } catch (std::exception& e) {
+    job.result = job_t::ERROR;
+    job.error = e.what();
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const char* isa = DEFAULT_ISA;
+  size_t nprocs = 1;
+  size_t mem_mb = 64;
+  uint64_t max_insns = 100000000;
+  size_t threads = 0;
+  bool verbose = false;
+
+  option_parser_t parser;
+  parser.help(&help);
+  parser.option('h', 0, 0, [&](const char* s){help();});
+  parser.option('p', 0, 1, [&](const char* s){nprocs = atoi(s);});
+  parser.option('m', 0, 1, [&](const char* s){mem_mb = atoi(s);});
+  parser.option('j', 0, 1, [&](const char* s){threads = atoi(s);});
+  parser.option('v', 0, 0, [&](const char* s){verbose = true;});
+  parser.option(0, "isa", 1, [&](const char* s){isa = s;});
+  parser.option(0, "max-insns", 1, [&](const char* s){max_insns = strtoull(s, NULL, 0);});
+
+  auto argv1 = parser.parse(argv);
+  if (!*argv1 || nprocs == 0 || mem_mb == 0)
+    help();
+
+  // programs named more than once are read once
+  std::map<std::string, std::shared_ptr<const elf_program_t>> programs;
+  std::vector<job_t> jobs;
+  for (auto arg = argv1; *arg; arg++) {
+    auto& p = programs[*arg];
+    if (!p) {
+      elf_program_t* prog = new elf_program_t;
+      prog->load(*arg);
+      p.reset(prog);
+    }
+    jobs.push_back({*arg, p, job_t::PENDING, 0, 0});
+  }
+
+  signal(SIGINT, &handle_signal);
+  {
+    thread_pool_t pool(threads);
+    for (auto& job : jobs) {
+      job_t* j = &job;
+      pool.submit([=]{ run(*j, isa, nprocs, mem_mb, max_insns); });
+    }
+    pool.wait();
+  }
+
+  size_t passed = 0, failed = 0;
+  for (auto& job : jobs) {
+    switch (job.result) {
+      case job_t::PASS:
+        printf("PASS    %s (%" PRIu64 " insns)\n", job.path, job.instret);
+        break;
+      case job_t::FAIL:
+        printf("FAIL    %s (exit code %" PRIu64 ")\n", job.path, job.exit_code);
+        break;
+      case job_t::TIMEOUT:
+        printf("TIMEOUT %s (%" PRIu64 " insns)\n", job.path, job.instret);
+        break;
+      case job_t::INTERRUPTED:
+        printf("STOPPED %s\n", job.path);
+        break;
+      default:
+        printf("ERROR   %s: %s\n", job.path, job.error.c_str());
+        break;
+    }
+    if (job.result == job_t::PASS)
+      passed++;
+    else
+      failed++;
+    if (!job.output.empty() && (verbose || job.result != job_t::PASS)) {
+      fputs(job.output.c_str(), stdout);
+      if (job.output.back() != '\n')
+        putchar('\n');
+    }
+  }
+  printf("%zu passed, %zu failed\n", passed, failed);
+  return failed != 0;
+}
@@ -0,0 +1,176 @@
+// See LICENSE for license details.
+
+// This program replays the instruction fetches and memory accesses in a
+// trace written by spike --trace into cache models, so cache experiments
+// don't have to re-run the program.  Every hierarchy sees the same accesses;
+// the hierarchies run on a pool of threads while the next chunk of the
+// trace is decoded.
+
+#include "cachesim.h"
+#include "trace_file.h"
+#include "thread_pool.h"
+#include <fesvr/option_parser.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+static void help()
+{
+  fprintf(stderr, "usage: spike-replay [options] <trace>\n");
+  fprintf(stderr, "Options:\n");
+  fprintf(stderr, "  --ic=<S>:<W>:<B>      Replay into cache models with S sets, W ways\n");
+  fprintf(stderr, "  --dc=<S>:<W>:<B>        and B-byte blocks, as in spike\n");
+  fprintf(stderr, "  --l2=<S>:<W>:<B>\n");
+  fprintf(stderr, "  --config=<list>       Also replay into the hierarchy in <list>, e.g.\n");
+  fprintf(stderr, "                          ic=64:4:64,dc=64:8:64,l2=1024:8:64; may be\n");
+  fprintf(stderr, "                          given more than once\n");
+  fprintf(stderr, "  -j<n>                 Use <n> threads [default one per CPU]\n");
+  fprintf(stderr, "  -h                    Print this help message\n");
+  exit(1);
+}
+
+// accesses decoded from the trace for each pass over the hierarchies
+static const size_t CHUNK = 1 << 16;
+
+struct access_t
+{
+  uint64_t addr;
+  uint64_t pc;
+  uint32_t bytes;
+  access_type type;
+};
+
+struct hierarchy_t
+{
+  std::string config;
+  // destroyed, printing their statistics, in the order spike uses
+  std::unique_ptr<cache_sim_t> ic;
+  std::unique_ptr<cache_sim_t> dc;
+  std::unique_ptr<cache_sim_t> l2;
+
+  hierarchy_t(const char* ic_config, const char* dc_config, const char* l2_config)
+  {
+    if (ic_config) ic.reset(cache_sim_t::construct(ic_config, "I$"));
+    if (dc_config) dc.reset(cache_sim_t::construct(dc_config, "D$"));
+    if (l2_config) l2.reset(cache_sim_t::construct(l2_config, "L2$"));
+    if (ic && l2) ic->set_miss_handler(&*l2);
+    if (dc && l2) dc->set_miss_handler(&*l2);
+  }
+
+  void replay(const std::vector<access_t>& accesses)
+  {
+    for (auto& a : accesses) {
+      cache_sim_t* c = a.type == FETCH ? ic.get() : dc.get();
+      if (c)
+        c->access(a.addr, a.bytes, a.type == STORE, a.pc);
+    }
+  }
+};
+
+static hierarchy_t* parse_config(const char* list)
+{
+  std::string s = list, config[3];
+  static const char* names[3] = {"ic", "dc", "l2"};
+  for (size_t pos = 0; pos <= s.size(); ) {
+    size_t comma = s.find(',', pos), eq = s.find('=', pos);
+    if (comma == std::string::npos)
+      comma = s.size();
+    if (eq >= comma)
+      help();
+    std::string name = s.substr(pos, eq - pos);
+    size_t i = 0;
+    while (i < 3 && name != names[i])
+      i++;
+    if (i == 3)
+      help();
+    config[i] = s.substr(eq + 1, comma - eq - 1);
+    pos = comma + 1;
+  }
+
+  auto c = [&](size_t i) { return config[i].empty() ? NULL : config[i].c_str(); };
+  hierarchy_t* h = new hierarchy_t(c(0), c(1), c(2));
+  h->config = list;
+  return h;
+}
+
+// decode up to CHUNK accesses, skipping fetches if no hierarchy wants them
+static void decode(trace_reader_t& reader, bool fetches, std::vector<access_t>& out)
+{
+  trace_record_t rec;
+  out.clear();
+  while (out.size() < CHUNK && reader.next(rec)) {
+    if (fetches)
+      out.push_back({rec.fetch_addr, rec.pc, uint32_t(trace_insn_length(rec.insn)), FETCH});
+    for (auto& a : rec.accesses) {
+      out.push_back({a.addr, rec.pc, a.size, a.store ? STORE : LOAD});
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const char* ic_config = NULL;
+  const char* dc_config = NULL;
+  const char* l2_config = NULL;
+  std::vector<std::unique_ptr<hierarchy_t>> hierarchies;
+  size_t threads = 0;
+
+  option_parser_t parser;
+  parser.help(&help);
+  parser.option('h', 0, 0, [&](const char* s){help();});
+  parser.option('j', 0, 1, [&](const char* s){threads = atoi(s);});
+  parser.option(0, "ic", 1, [&](const char* s){ic_config = s;});
+  parser.option(0, "dc", 1, [&](const char* s){dc_config = s;});
+  parser.option(0, "l2", 1, [&](const char* s){l2_config = s;});
+  parser.option(0, "config", 1, [&](const char* s){hierarchies.emplace_back(parse_config(s));});
+
+  auto argv1 = parser.parse(argv);
+  if (!*argv1 || argv1[1])
+    help();
+  if (ic_config || dc_config || l2_config) {
+    hierarchies.emplace_back(new hierarchy_t(ic_config, dc_config, l2_config));
+    hierarchies.back()->config = "--ic/--dc/--l2";
+  }
+  if (hierarchies.empty()) {
+    fprintf(stderr, "spike-replay: no cache models given\n");
+    return 1;
+  }
+
+  trace_reader_t reader;
+  if (!reader.open(*argv1)) {
+    fprintf(stderr, "spike-replay: %s\n", reader.error());
+    return 1;
+  }
+
+  bool fetches = false;
+  for (auto& h : hierarchies)
+    fetches |= h->ic != NULL;
+
+  thread_pool_t pool(threads);
+  std::vector<access_t> cur, next;
+  decode(reader, fetches, cur);
+  while (!cur.empty()) {
+    for (auto& h : hierarchies) {
+      hierarchy_t* p = h.get();
+      pool.submit([p, &cur]{ p->replay(cur); });
+    }
+    decode(reader, fetches, next);
+    pool.wait();
+    std::swap(cur, next);
+  }
+
+  if (*reader.error()) {
+    fprintf(stderr, "spike-replay: %s\n", reader.error());
+    return 1;
+  }
+
+  for (auto& h : hierarchies) {
+    if (hierarchies.size() > 1)
+      std::cout << "== " << h->config << " ==" << std::endl;
+    h.reset();
+  }
+  return 0;
+}
@@ -4,7 +4,13 @@
 #include "mmu.h"
 #include "gdbserver.h"
 #include "cachesim.h"
+#include "cachesweep.h"
 #include "extension.h"
+#include "profiler.h"
+#include "branchpred.h"
+#include "timing.h"
+#include "trace_writer.h"
+#include "shared_mem.h"
 #include <dlfcn.h>
 #include <fesvr/option_parser.h>
 #include <stdio.h>
@@ -28,10 +34,43 @@ static void help()
   fprintf(stderr, "  --ic=<S>:<W>:<B>      Instantiate a cache model with S sets,\n");
   fprintf(stderr, "  --dc=<S>:<W>:<B>        W ways, and B-byte blocks (with S and\n");
   fprintf(stderr, "  --l2=<S>:<W>:<B>        B both powers of 2).\n");
+  fprintf(stderr, "  --l2-threads=<n>      Split the L2 model's sets across <n> threads\n");
+  fprintf(stderr, "  --ic-prefetch=<P>     Attach a prefetcher to a cache model, where P is\n");
+  fprintf(stderr, "  --dc-prefetch=<P>       next-line[:N], stride[:N[:entries]] or\n");
+  fprintf(stderr, "  --l2-prefetch=<P>       stream[:buffers[:depth]]\n");
+  fprintf(stderr, "  --ic-sweep=<MIN>:<MAX>:<W>:<B>  Report LRU miss rates for every cache\n");
+  fprintf(stderr, "  --dc-sweep=<MIN>:<MAX>:<W>:<B>    of MIN to MAX bytes with up to W ways\n");
+  fprintf(stderr, "                          and B-byte blocks, in a single run\n");
   fprintf(stderr, "  --extension=<name>    Specify RoCC Extension\n");
   fprintf(stderr, "  --extlib=<name>       Shared library to load\n");
   fprintf(stderr, "  --gdb-port=<port>  Listen on <port> for gdb to connect\n");
   fprintf(stderr, "  --dump-config-string  Print platform configuration string and exit\n");
+  fprintf(stderr, "  --htif-latency=<n>    Poll the host at least every <n> instructions\n");
+  fprintf(stderr, "  --stats=<file>        Write simulator statistics to <file> as JSON at exit\n");
+  fprintf(stderr, "                          and on SIGUSR1 (\"-\" for stderr)\n");
+  fprintf(stderr, "  --stats-interval=<s>  Report each processor's MIPS every <s> seconds\n");
+  fprintf(stderr, "  --roi                 Leave cache models and -l off until the guest\n");
+  fprintf(stderr, "                          turns them on with \"slti x0, x0, 0x7f0+<op>\" hints\n");
+  fprintf(stderr, "  --insn-mix            Report each processor's instruction mix at exit\n");
+  fprintf(stderr, "  --bpred=<P>[:<b>[:<t>[:<r>]]]  Model a bimodal, gshare or tage predictor\n");
+  fprintf(stderr, "                          with 2^b-entry tables, a t-entry BTB and an\n");
+  fprintf(stderr, "                          r-entry RAS, and report MPKI at exit\n");
+  fprintf(stderr, "  --timing=<list>       Count mcycle with an in-order timing model,\n");
+  fprintf(stderr, "                          e.g. mul=3,mem=80 (\"default\" for defaults)\n");
+  fprintf(stderr, "  --trace=<file>        Write a compressed trace of retired instructions\n");
+  fprintf(stderr, "                          and their memory accesses to <file> (<file>.<n>\n");
+  fprintf(stderr, "                          for processor n if there are several)\n");
+  fprintf(stderr, "  --mem-file=<file>     Keep target memory in <file>, or in the POSIX shared\n");
+  fprintf(stderr, "                          memory object <name> for shm:<name>, so another\n");
+  fprintf(stderr, "                          process can map it too\n");
+  fprintf(stderr, "  --mem-golden          Only read --mem-file; the target gets a private copy\n");
+  fprintf(stderr, "  --mem-ring=<file>     Post the address of every store to the ring in\n");
+  fprintf(stderr, "                          <file> or shm:<name> (see shared_mem.h)\n");
+  fprintf(stderr, "  --profile=<file>      Write a collapsed-stack guest profile to <file>\n");
+  fprintf(stderr, "  --profile-symbols=<elf>  Also symbolize the profile against <elf>\n");
+  fprintf(stderr, "  --icache-size=<n>     Cache <n> decoded instructions per processor\n");
+  fprintf(stderr, "                          (a power of 2, at least 1024) [default %zu]\n",
+          (size_t)mmu_t::DEFAULT_ICACHE_SIZE);
   exit(1);
 }
 
@@ -40,16 +79,37 @@ int main(int argc, char** argv)
   bool debug = false;
   bool halted = false;
   bool histogram = false;
+  bool insn_mix = false;
   bool log = false;
   bool dump_config_string = false;
+  bool roi = false;
   size_t nprocs = 1;
   size_t mem_mb = 0;
   std::unique_ptr<icache_sim_t> ic;
   std::unique_ptr<dcache_sim_t> dc;
   std::unique_ptr<cache_sim_t> l2;
+  const char* l2_config = NULL;
+  size_t l2_threads = 1;
+  const char* ic_prefetch = NULL;
+  const char* dc_prefetch = NULL;
+  const char* l2_prefetch = NULL;
+  std::unique_ptr<cache_sweep_t> ic_sweep;
+  std::unique_ptr<cache_sweep_t> dc_sweep;
   std::function<extension_t*()> extension;
   const char* isa = DEFAULT_ISA;
   uint16_t gdb_port = 0;
+  size_t htif_latency = 0;
+  size_t icache_size = 0;
+  const char* stats_file = NULL;
+  const char* profile_file = NULL;
+  const char* bpred_config = NULL;
+  const char* timing_config = NULL;
+  const char* trace_file = NULL;
+  const char* mem_file = NULL;
+  bool mem_golden = false;
+  const char* mem_ring = NULL;
+  std::vector<const char*> profile_symbols;
+  double stats_interval = 0;
 
   option_parser_t parser;
   parser.help(&help);
@@ -64,10 +124,34 @@ int main(int argc, char** argv)
   parser.option(0, "gdb-port", 1, [&](const char* s){gdb_port = atoi(s);});
   parser.option(0, "ic", 1, [&](const char* s){ic.reset(new icache_sim_t(s));});
   parser.option(0, "dc", 1, [&](const char* s){dc.reset(new dcache_sim_t(s));});
-  parser.option(0, "l2", 1, [&](const char* s){l2.reset(cache_sim_t::construct(s, "L2$"));});
+  parser.option(0, "l2", 1, [&](const char* s){l2_config = s;});
+  parser.option(0, "l2-threads", 1, [&](const char* s){l2_threads = atoi(s);});
+  parser.option(0, "ic-prefetch", 1, [&](const char* s){ic_prefetch = s;});
+  parser.option(0, "dc-prefetch", 1, [&](const char* s){dc_prefetch = s;});
+  parser.option(0, "l2-prefetch", 1, [&](const char* s){l2_prefetch = s;});
+  parser.option(0, "ic-sweep", 1, [&](const char* s){ic_sweep.reset(new cache_sweep_t(s, "I$", true));});
+  parser.option(0, "dc-sweep", 1, [&](const char* s){dc_sweep.reset(new cache_sweep_t(s, "D$", false));});
   parser.option(0, "isa", 1, [&](const char* s){isa = s;});
   parser.option(0, "extension", 1, [&](const char* s){extension = find_extension(s);});
   parser.option(0, "dump-config-string", 0, [&](const char *s){dump_config_string = true;});
+  parser.option(0, "htif-latency", 1, [&](const char *s){htif_latency = atoi(s);});
+  parser.option(0, "stats", 1, [&](const char *s){stats_file = s;});
+  parser.option(0, "stats-interval", 1, [&](const char *s){stats_interval = atof(s);});
+  parser.option(0, "roi", 0, [&](const char *s){roi = true;});
+  parser.option(0, "insn-mix", 0, [&](const char *s){insn_mix = true;});
+  parser.option(0, "bpred", 1, [&](const char *s){bpred_config = s;});
+  parser.option(0, "timing", 1, [&](const char *s){timing_config = s;});
+  parser.option(0, "trace", 1, [&](const char *s){trace_file = s;});
+  parser.option(0, "mem-file", 1, [&](const char *s){mem_file = s;});
+  parser.option(0, "mem-golden", 0, [&](const char *s){mem_golden = true;});
+  parser.option(0, "mem-ring", 1, [&](const char *s){mem_ring = s;});
+  parser.option(0, "profile", 1, [&](const char *s){profile_file = s;});
+  parser.option(0, "profile-symbols", 1, [&](const char *s){profile_symbols.push_back(s);});
+  parser.option(0, "icache-size", 1, [&](const char *s){
+    icache_size = atoi(s);
+    if (icache_size < mmu_t::ICACHE_ENTRIES || (icache_size & (icache_size-1)))
+      help();
+  });
   parser.option(0, "extlib", 1, [&](const char *s){
     void *lib = dlopen(s, RTLD_NOW | RTLD_GLOBAL);
     if (lib == NULL) {
@@ -77,8 +161,29 @@ int main(int argc, char** argv)
   });
 
   auto argv1 = parser.parse(argv);
+  if (l2_config)
+    l2.reset(cache_sim_t::construct(l2_config, "L2$", l2_threads));
+  if (l2_prefetch && l2_threads > 1) {
+    fprintf(stderr, "--l2-prefetch can't be used with --l2-threads\n");
+    return 1;
+  }
+  // the timing model charges an access by how the misses counted while it
+  // ran, which a sharded L2 only knows once its threads catch up
+  if (timing_config && l2_config && l2_threads > 1) {
+    fprintf(stderr, "--timing can't be used with --l2-threads\n");
+    return 1;
+  }
+  if (ic && ic_prefetch) ic->set_prefetcher(ic_prefetch);
+  if (dc && dc_prefetch) dc->set_prefetcher(dc_prefetch);
+  if (l2 && l2_prefetch) l2->set_prefetcher(l2_prefetch);
+  if (mem_ring && (!mem_file || mem_golden)) {
+    fprintf(stderr, "--mem-ring needs a shared --mem-file\n");
+    return 1;
+  }
   std::vector<std::string> htif_args(argv1, (const char*const*)argv + argc);
   sim_t s(isa, nprocs, mem_mb, halted, htif_args);
+  if (mem_file)
+    s.map_mem(mem_file, !mem_golden);
   std::unique_ptr<gdbserver_t> gdbserver;
   if (gdb_port) {
     gdbserver = std::unique_ptr<gdbserver_t>(new gdbserver_t(gdb_port, &s));
@@ -97,13 +202,82 @@ int main(int argc, char** argv)
   if (dc && l2) dc->set_miss_handler(&*l2);
   for (size_t i = 0; i < nprocs; i++)
   {
-    if (ic) s.get_core(i)->get_mmu()->register_memtracer(&*ic);
-    if (dc) s.get_core(i)->get_mmu()->register_memtracer(&*dc);
+    if (icache_size) s.get_core(i)->get_mmu()->set_icache_size(icache_size);
+    if (ic) s.add_memtracer(i, &*ic);
+    if (dc) s.add_memtracer(i, &*dc);
+    if (ic_sweep) s.add_memtracer(i, &*ic_sweep);
+    if (dc_sweep) s.add_memtracer(i, &*dc_sweep);
     if (extension) s.get_core(i)->register_extension(extension());
   }
 
+  std::vector<std::unique_ptr<trace_writer_t>> trace_writers;
+  for (size_t i = 0; trace_file && i < nprocs; i++) {
+    std::string path = trace_file;
+    if (nprocs > 1)
+      path += "." + std::to_string(i);
+    trace_writers.emplace_back(new trace_writer_t(path.c_str()));
+    s.set_trace_writer(i, &*trace_writers.back());
+  }
+
+  // stores reach the ring whether or not the region of interest is on
+  std::unique_ptr<store_ring_t> store_ring;
+  if (mem_ring) {
+    store_ring.reset(new store_ring_t(mem_ring));
+    s.get_debug_mmu()->register_access_tracer(&*store_ring);
+    for (size_t i = 0; i < nprocs; i++)
+      s.get_core(i)->get_mmu()->register_access_tracer(&*store_ring);
+  }
+
   s.set_debug(debug);
   s.set_log(log);
+  s.set_roi(roi);
   s.set_histogram(histogram);
-  return s.run();
+  s.set_insn_mix(insn_mix);
+  if (htif_latency)
+    s.set_htif_latency(htif_latency);
+  if (stats_file)
+    s.set_stats_file(stats_file);
+  s.set_stats_interval(stats_interval);
+
+  std::unique_ptr<profiler_t> profiler;
+  if (profile_file) {
+    profiler.reset(new profiler_t(nprocs));
+    // the target program (and, under pk, the user program) are usually ELF
+    for (auto& arg : htif_args)
+      profiler->add_symbols(arg.c_str());
+    for (auto fn : profile_symbols)
+      if (!profiler->add_symbols(fn))
+        fprintf(stderr, "warning: no symbols loaded from %s\n", fn);
+    s.set_profiler(&*profiler);
+  }
+
+  std::unique_ptr<branch_predictor_t> bpred;
+  if (bpred_config) {
+    bpred.reset(new branch_predictor_t(bpred_config, nprocs));
+    s.set_branch_tracer(&*bpred);
+  }
+
+  std::unique_ptr<timing_model_t> timing;
+  if (timing_config) {
+    timing.reset(new timing_model_t(timing_config, nprocs));
+    timing->set_caches(ic ? ic->get_cache() : NULL, dc ? dc->get_cache() : NULL, l2.get());
+    timing->set_branch_predictor(bpred.get());
+    s.set_timing_model(&*timing);
+  }
+
+  int exit_code = s.run();
+
+  if (bpred)
+    bpred->print_stats();
+
+  if (profiler) {
+    FILE* out = fopen(profile_file, "w");
+    if (!out) {
+      fprintf(stderr, "could not open %s\n", profile_file);
+      return -1;
+    }
+    profiler->write(out);
+    fclose(out);
+  }
+  return exit_code;
 }
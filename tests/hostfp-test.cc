@@ -0,0 +1,92 @@
+// See LICENSE for license details.
+
+// Checks that hostfp.h gives the same results and flags as softfloat for
+// random operands in every rounding mode, weighted towards the special
+// cases: zeros, infinities, NaNs, subnormals and exponents near overflow
+// and underflow.
+
+#include "hostfp.h"
+#include <cinttypes>
+#include <cstdio>
+#include <random>
+
+static std::mt19937_64 rng(1);
+static long tests, failures;
+
+static const uint64_t special64[] = {
+  0x0000000000000000, 0x8000000000000000, 0x3ff0000000000000,
+  0xbff0000000000000, 0x7ff0000000000000, 0xfff0000000000000,
+  0x7ff8000000000000, 0x7ff4000000000000, 0x0000000000000001,
+  0x000fffffffffffff, 0x0010000000000000, 0x7fefffffffffffff,
+  0x3ff0000000000001, 0x4000000000000000,
+};
+
+static float64_t random64()
+{
+  const uint64_t sign_frac = 0x800fffffffffffff;
+  uint64_t x;
+  switch (rng() % 6) {
+    case 0: x = special64[rng() % (sizeof(special64) / sizeof(special64[0]))]; break;
+    case 1: x = (rng() & sign_frac) | (rng() % 8) << 52; break;
+    case 2: x = (rng() & sign_frac) | (0x7f8 + rng() % 7) << 52; break;
+    case 3: x = (rng() & sign_frac) | (0x3f0 + rng() % 32) << 52; break;
+    default: x = rng(); break;
+  }
+  return float64_t{x};
+}
+
+static float32_t random32()
+{
+  const uint32_t sign_frac = 0x807fffff;
+  uint32_t x;
+  switch (rng() % 4) {
+    case 0: x = random64().v >> 32; break;
+    case 1: x = (rng() & sign_frac) | (rng() % 6) << 23; break;
+    case 2: x = (rng() & sign_frac) | (0xf8 + rng() % 7) << 23; break;
+    default: x = rng(); break;
+  }
+  return float32_t{x};
+}
+
+// hostfp only uses the host once the guest's inexact flag is set, which is
+// also when it can't change the flags softfloat would raise
+#define CHECK(op, ...) \
+  do { \
+    softfloat_exceptionFlags = softfloat_flag_inexact; \
+    auto want = op(__VA_ARGS__); \
+    uint_fast8_t want_flags = softfloat_exceptionFlags; \
+    softfloat_exceptionFlags = softfloat_flag_inexact; \
+    auto got = hostfp_##op(softfloat_flag_inexact, __VA_ARGS__); \
+    uint_fast8_t got_flags = softfloat_exceptionFlags; \
+    tests++; \
+    if ((got.v != want.v || got_flags != want_flags) && failures++ < 10) \
+      printf(#op " rm=%d: %" PRIx64 "/%x, want %" PRIx64 "/%x\n", \
+             int(softfloat_roundingMode), uint64_t(got.v), int(got_flags), \
+             uint64_t(want.v), int(want_flags)); \
+  } while (0)
+
+int main()
+{
+  for (int i = 0; i < 3000000; i++) {
+    softfloat_roundingMode = i % 5;
+    float64_t a = random64(), b = random64(), c = random64();
+    float32_t x = random32(), y = random32(), z = random32();
+
+    CHECK(f64_add, a, b);
+    CHECK(f64_sub, a, b);
+    CHECK(f64_mul, a, b);
+    CHECK(f64_div, a, b);
+    CHECK(f64_sqrt, a);
+    CHECK(f64_mulAdd, a, b, c);
+    CHECK(f32_add, x, y);
+    CHECK(f32_sub, x, y);
+    CHECK(f32_mul, x, y);
+    CHECK(f32_div, x, y);
+    CHECK(f32_sqrt, x);
+    CHECK(f32_mulAdd, x, y, z);
+  }
+
+  printf("%ld operations, %ld mismatches\n", tests, failures);
+  puts(failures ? "FAILED" : "PASSED");
+  return failures != 0;
+}
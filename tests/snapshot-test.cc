@@ -0,0 +1,124 @@
+// See LICENSE for license details.
+
+// Checks through libspike that restore() puts a machine back as it was at
+// snapshot(): registers, the pc, memory written by the hart and through
+// the debug port, and the counters, so that every run from the snapshot
+// retires the same instructions and gets the same results.
+
+#include "libspike.h"
+#include "encoding.h"
+#include "processor.h"
+#include <cinttypes>
+#include <cstdio>
+
+static long failures;
+
+#define CHECK(cond, ...) \
+  do { \
+    if (!(cond) && failures++ < 10) { \
+      printf(__VA_ARGS__); \
+      printf("\n"); \
+    } \
+  } while (0)
+
+static uint64_t load64(spike_t* s, uint64_t addr)
+{
+  uint64_t x = 0;
+  CHECK(spike_read_mem(s, addr, 8, &x) == 0, "read %" PRIx64 " failed", addr);
+  return x;
+}
+
+static uint64_t csr(spike_t* s, unsigned which)
+{
+  uint64_t x = 0;
+  CHECK(spike_get_csr(s, 0, which, &x) == 0, "csr %x doesn't exist", which);
+  return x;
+}
+
+static uint64_t pc(spike_t* s)
+{
+  uint64_t x = 0;
+  CHECK(spike_get_pc(s, 0, &x) == 0, "hart 0 doesn't exist");
+  return x;
+}
+
+static uint64_t xreg(spike_t* s, unsigned reg)
+{
+  uint64_t x = 0;
+  CHECK(spike_get_xreg(s, 0, reg, &x) == 0, "x%u doesn't exist", reg);
+  return x;
+}
+
+static uint64_t freg(spike_t* s, unsigned reg)
+{
+  uint64_t x = 0;
+  CHECK(spike_get_freg(s, 0, reg, &x) == 0, "f%u doesn't exist", reg);
+  return x;
+}
+
+int main()
+{
+  spike_t* s = spike_new("RV64IMAFDC", 1, 16);
+  uint64_t base = spike_mem_base(s);
+
+  // counts x = *(base + 1 MiB - 8) + 1 into a2 and stores it back, then
+  // stores 64..1 to every 512 bytes from base + 1 MiB, dirtying 8 pages
+  const uint32_t prog[] = {
+    0x00100517, // auipc a0, 0x100
+    0x04000593, // li    a1, 64
+    0xff853603, // ld    a2, -8(a0)
+    0x00160613, // addi  a2, a2, 1
+    0xfec53c23, // sd    a2, -8(a0)
+    0x00b53023, // 1: sd a1, 0(a0)
+    0x20050513, // addi  a0, a0, 512
+    0xfff58593, // addi  a1, a1, -1
+    0xfe059ae3, // bnez  a1, 1b
+    0x0000006f, // j     .
+  };
+  const uint64_t done = base + 4 * 9, counter = base + 0x100000 - 8;
+  const uint32_t addi5 = 0x00560613; // addi a2, a2, 5
+  CHECK(spike_write_mem(s, base, sizeof(prog), prog) == 0, "can't load program");
+  CHECK(spike_set_csr(s, 0, CSR_MHPMEVENT3, HPM_STORE) == 0, "can't count stores");
+
+  uint64_t start_pc = pc(s);
+  uint64_t start_minstret = csr(s, CSR_MINSTRET);
+  CHECK(spike_snapshot(s) == 0, "can't snapshot");
+
+  uint64_t minstret = 0;
+  for (int run = 0; run < 4; run++) {
+    // change what restore has to undo
+    spike_set_xreg(s, 0, 20, run + 1);
+    spike_set_freg(s, 0, 1, run + 1);
+    if (run == 2)
+      spike_write_mem(s, base + 12, 4, &addi5);
+
+    spike_step(s, 1000);
+    CHECK(pc(s) == done, "run %d: pc %" PRIx64, run, pc(s));
+    uint64_t a2 = xreg(s, 12);
+    CHECK(a2 == (run == 2 ? 5 : 1), "run %d: a2 is %" PRIu64, run, a2);
+    CHECK(load64(s, counter) == a2, "run %d: counter is %" PRIu64, run, load64(s, counter));
+    CHECK(load64(s, base + 0x100000 + 63 * 512) == 1, "run %d: last store missing", run);
+    CHECK(csr(s, CSR_MHPMCOUNTER3) == 65, "run %d: %" PRIu64 " stores counted",
+          run, csr(s, CSR_MHPMCOUNTER3));
+    if (run == 0)
+      minstret = csr(s, CSR_MINSTRET);
+    CHECK(csr(s, CSR_MINSTRET) == minstret, "run %d: minstret %" PRIu64 ", want %" PRIu64,
+          run, csr(s, CSR_MINSTRET), minstret);
+
+    CHECK(spike_restore(s) == 0, "run %d: can't restore", run);
+    CHECK(pc(s) == start_pc, "run %d: restored pc %" PRIx64, run, pc(s));
+    CHECK(xreg(s, 20) == 0 && xreg(s, 12) == 0 && freg(s, 1) == 0,
+          "run %d: registers not restored", run);
+    CHECK(csr(s, CSR_MINSTRET) == start_minstret && csr(s, CSR_MHPMCOUNTER3) == 0,
+          "run %d: counters not restored", run);
+    CHECK(load64(s, counter) == 0 && load64(s, base + 0x100000) == 0,
+          "run %d: memory not restored", run);
+    uint32_t insn = 0;
+    spike_read_mem(s, base + 12, 4, &insn);
+    CHECK(insn == prog[3], "run %d: program not restored", run);
+  }
+
+  spike_delete(s);
+  puts(failures ? "FAILED" : "PASSED");
+  return failures != 0;
+}
@@ -0,0 +1,254 @@
+// See LICENSE for license details.
+
+// Checks that trace files read back as they were written: the tracez codec
+// on its own, trace_writer_t and trace_reader_t on synthetic records that
+// span many blocks, a hart running with Sv39 translation on, whose records
+// must carry the physical address each instruction came from, and vector
+// loads and stores, whose records must carry every element they access.
+
+#include "trace_writer.h"
+#include "trace_file.h"
+#include "processor.h"
+#include "sim.h"
+#include "mmu.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <random>
+#include <unistd.h>
+
+static std::mt19937_64 rng(1);
+static long failures;
+
+#define CHECK(cond, ...) \
+  do { \
+    if (!(cond) && failures++ < 10) { \
+      printf(__VA_ARGS__); \
+      printf("\n"); \
+    } \
+  } while (0)
+
+static void test_tracez(const char* what, const std::vector<uint8_t>& in)
+{
+  std::vector<uint8_t> packed(tracez_bound(in.size()));
+  packed.resize(tracez_compress(in.data(), in.size(), packed.data()));
+  std::vector<uint8_t> out(in.size() + 1);
+  CHECK(tracez_decompress(packed.data(), packed.size(), out.data(), in.size())
+        && std::equal(in.begin(), in.end(), out.begin()),
+        "tracez: %s: %zu bytes don't round trip", what, in.size());
+  CHECK(!tracez_decompress(packed.data(), packed.size(), out.data(), in.size() + 1),
+        "tracez: %s: %zu bytes decompressed to %zu", what, in.size(), in.size() + 1);
+}
+
+static void test_tracez()
+{
+  for (size_t n : {0, 1, 4, 15, 16, 300, 70000, 300000}) {
+    std::vector<uint8_t> zeros(n), random(n), text(n);
+    for (size_t i = 0; i < n; i++) {
+      random[i] = rng();
+      text[i] = "spike traces "[rng() % 13] + (rng() % 64 == 0);
+    }
+    test_tracez("zeros", zeros);
+    test_tracez("random", random);
+    test_tracez("text", text);
+  }
+}
+
+static void test_round_trip(const char* path)
+{
+  const size_t n = 200000;
+  std::vector<trace_record_t> want(n);
+  {
+    trace_writer_t w(path);
+    uint64_t pc = 0x80000000, bias = 0;
+    for (size_t i = 0; i < n; i++) {
+      trace_record_t& r = want[i];
+      if (rng() % 50 == 0)
+        bias = rng() % 4 == 0 ? 0 : (rng() & 0xfffff000) - 0x80000000;
+      r.pc = pc;
+      r.fetch_addr = pc + bias;
+      r.insn = rng() % 3 == 0 ? (rng() & 0xfffc) | rng() % 3
+                              : (rng() & 0xffffffe3) | 0x13 | (rng() % 3 << 2);
+      size_t len = trace_insn_length(r.insn);
+      r.npc = rng() % 8 == 0 ? pc + ((rng() % 8192) - 4096) * 2 : pc + len;
+      r.jumped = r.npc != pc + len;
+      r.reg = rng() % 4 == 0 ? -1 : 1 + rng() % 63;
+      r.value = r.reg < 0 ? 0 : rng() % 2 ? rng() : rng() % 256;
+      // mostly none, sometimes more than fit in the flags
+      size_t accesses = rng() % 4 ? 0 : rng() % 64 ? rng() % 20 : rng() % 600;
+      for (size_t j = 0; j < accesses; j++)
+        r.accesses.push_back({0x80000000 + (rng() & 0xffffff),
+                              uint8_t(1 << rng() % 4), rng() % 2 == 0});
+
+      w.begin(r.fetch_addr);
+      for (auto& a : r.accesses)
+        w.trace(a.addr, a.size, a.store ? STORE : LOAD);
+      commit_log_reg_t write = {0, r.value};
+      if (r.reg >= 0)
+        write.addr = (r.reg & 31) << 1 | (r.reg >= 32);
+      w.retire(r.pc, insn_t(r.insn), r.npc, write);
+      pc = r.npc;
+    }
+  }
+
+  trace_reader_t reader;
+  if (!reader.open(path)) {
+    CHECK(false, "open %s: %s", path, reader.error());
+    return;
+  }
+  CHECK(reader.size() == n, "%" PRIu64 " records, want %zu", reader.size(), n);
+
+  auto check = [&](size_t i) {
+    trace_record_t got;
+    if (!reader.next(got)) {
+      CHECK(false, "record %zu missing: %s", i, reader.error());
+      return false;
+    }
+    const trace_record_t& r = want[i];
+    bool same = got.pc == r.pc && got.fetch_addr == r.fetch_addr &&
+                got.insn == r.insn && got.npc == r.npc && got.jumped == r.jumped &&
+                got.reg == r.reg && got.value == r.value &&
+                got.accesses.size() == r.accesses.size();
+    for (size_t j = 0; same && j < r.accesses.size(); j++)
+      same = got.accesses[j].addr == r.accesses[j].addr &&
+             got.accesses[j].size == r.accesses[j].size &&
+             got.accesses[j].store == r.accesses[j].store;
+    CHECK(same, "record %zu: pc %" PRIx64 " fetch_addr %" PRIx64
+          ", want pc %" PRIx64 " fetch_addr %" PRIx64,
+          i, got.pc, got.fetch_addr, r.pc, r.fetch_addr);
+    return same;
+  };
+
+  for (size_t i = 0; i < n; i++)
+    if (!check(i))
+      break;
+  trace_record_t extra;
+  CHECK(!reader.next(extra) && !*reader.error(), "records past the end");
+
+  for (int i = 0; i < 100; i++) {
+    size_t start = rng() % n;
+    CHECK(reader.seek(start), "seek %zu: %s", start, reader.error());
+    for (size_t j = start; j < std::min(n, start + 10); j++)
+      if (!check(j))
+        break;
+  }
+}
+
+static void test_sv39(const char* path)
+{
+  std::vector<std::string> args;
+  sim_t s("RV64IMAFDC", 1, 16, false, args);
+  processor_t* p = s.get_core(0);
+  mmu_t* mmu = s.get_debug_mmu();
+
+  // a loop at virtual address 0 that stores to and loads from 0x1000
+  const uint32_t prog[] = {
+    0x00001297, 0x001005b7, 0x00b2b023, 0x0002b603, 0xfff58593,
+    0x02c60633, 0x00c686b3, 0xfe0596e3, 0x0000006f,
+  };
+  for (size_t i = 0; i < sizeof(prog) / sizeof(prog[0]); i++)
+    mmu->store_uint32(DRAM_BASE + 4 * i, prog[i]);
+  // one 1 GiB page maps virtual 0 to DRAM_BASE
+  reg_t root = DRAM_BASE + 0x100000;
+  mmu->store_uint64(root, (DRAM_BASE >> 12) << 10 | PTE_V | PTE_R | PTE_W |
+                          PTE_X | PTE_A | PTE_D);
+  p->set_csr(CSR_SPTBR, root >> 12);
+  p->set_csr(CSR_MSTATUS, set_field(p->get_state()->mstatus, MSTATUS_VM, VM_SV39));
+  p->get_state()->prv = PRV_S;
+  p->get_state()->pc = 0;
+
+  trace_writer_t* w = new trace_writer_t(path);
+  s.set_trace_writer(0, w);
+  s.step(1000);
+  s.set_trace_writer(0, NULL);
+  delete w;
+
+  trace_reader_t reader;
+  if (!reader.open(path)) {
+    CHECK(false, "open %s: %s", path, reader.error());
+    return;
+  }
+  CHECK(reader.size() == 1000, "sv39: %" PRIu64 " records, want 1000", reader.size());
+  trace_record_t rec;
+  size_t stores = 0;
+  while (reader.next(rec)) {
+    CHECK(rec.pc < 4 * sizeof(prog) / sizeof(prog[0]) &&
+          rec.fetch_addr == rec.pc + DRAM_BASE,
+          "sv39: pc %" PRIx64 " fetched from %" PRIx64, rec.pc, rec.fetch_addr);
+    for (auto& a : rec.accesses) {
+      CHECK(a.addr == DRAM_BASE + 0x1000, "sv39: access to %" PRIx64
+            " at pc %" PRIx64, a.addr, rec.pc);
+      stores += a.store;
+    }
+  }
+  CHECK(!*reader.error(), "sv39: %s", reader.error());
+  CHECK(stores > 100, "sv39: only %zu stores", stores);
+}
+
+static void test_vector(const char* path)
+{
+  std::vector<std::string> args;
+  sim_t s("RV64IMAFDCXVSUBSET", 1, 16, false, args);
+  processor_t* p = s.get_core(0);
+  mmu_t* mmu = s.get_debug_mmu();
+
+  // vsetvli t0, t1, e8, m8; vle8.v v8, (t2); vse8.v v8, (t3); j .
+  const uint32_t prog[] = {
+    MATCH_VSETVLI | 3 << 20 | 6 << 15 | 5 << 7,
+    MATCH_VLE8_V | 1 << 25 | 7 << 15 | 8 << 7,
+    MATCH_VSE8_V | 1 << 25 | 28 << 15 | 8 << 7,
+    0x0000006f,
+  };
+  for (size_t i = 0; i < sizeof(prog) / sizeof(prog[0]); i++)
+    mmu->store_uint32(DRAM_BASE + 4 * i, prog[i]);
+  const reg_t src = DRAM_BASE + 0x1000, dst = DRAM_BASE + 0x2000;
+  state_t* state = p->get_state();
+  p->set_csr(CSR_MSTATUS, state->mstatus | MSTATUS_FS);
+  state->XPR.write(6, 1000);
+  state->XPR.write(7, src);
+  state->XPR.write(28, dst);
+  state->pc = DRAM_BASE;
+
+  trace_writer_t* w = new trace_writer_t(path);
+  s.set_trace_writer(0, w);
+  s.step(4);
+  s.set_trace_writer(0, NULL);
+  delete w;
+
+  // with e8 and LMUL 8 that's VLEN elements, well past the 15 the flags hold
+  const size_t vl = VLEN;
+  CHECK(state->XPR[5] == vl, "vector: vl is %" PRIu64 ", want %zu",
+        uint64_t(state->XPR[5]), vl);
+
+  trace_reader_t reader;
+  if (!reader.open(path)) {
+    CHECK(false, "open %s: %s", path, reader.error());
+    return;
+  }
+  trace_record_t rec;
+  for (int i = 0; i < 4 && reader.next(rec); i++) {
+    bool store = i == 2;
+    size_t want = i == 1 || i == 2 ? vl : 0;
+    CHECK(rec.accesses.size() == want, "vector: pc %" PRIx64 " made %zu accesses, "
+          "want %zu", rec.pc, rec.accesses.size(), want);
+    for (size_t j = 0; j < rec.accesses.size(); j++) {
+      const trace_access_t& a = rec.accesses[j];
+      CHECK(a.addr == (store ? dst : src) + j && a.size == 1 && a.store == store,
+            "vector: pc %" PRIx64 " access %zu to %" PRIx64, rec.pc, j, a.addr);
+    }
+  }
+  CHECK(!*reader.error(), "vector: %s", reader.error());
+}
+
+int main()
+{
+  const char* path = "trace-test.junk-dat";
+  test_tracez();
+  test_round_trip(path);
+  test_sv39(path);
+  test_vector(path);
+  unlink(path);
+
+  puts(failures ? "FAILED" : "PASSED");
+  return failures != 0;
+}
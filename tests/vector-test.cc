@@ -0,0 +1,167 @@
+// See LICENSE for license details.
+
+// Checks through libspike that vsetvli, vsetivli and vsetvl accept exactly
+// the legal vtypes and compute vl as the vector spec says, including the
+// rs1 = x0 forms, and that the vector subset is only there when the ISA
+// string asks for it and isn't reported in misa.  Also checks that libspike
+// turns down ISA strings, harts and registers that don't exist.
+
+#include "libspike.h"
+#include "encoding.h"
+#include <cinttypes>
+#include <cstdio>
+#include <initializer_list>
+
+static long failures;
+
+#define CHECK(cond, ...) \
+  do { \
+    if (!(cond) && failures++ < 10) { \
+      printf(__VA_ARGS__); \
+      printf("\n"); \
+    } \
+  } while (0)
+
+static const uint64_t ELEN = 64;
+static const uint64_t VILL = uint64_t(1) << 63;
+
+static uint32_t vsetvli(unsigned rd, unsigned rs1, uint32_t vtype)
+{
+  return MATCH_VSETVLI | vtype << 20 | rs1 << 15 | rd << 7;
+}
+static uint32_t vsetivli(unsigned rd, unsigned avl, uint32_t vtype)
+{
+  return MATCH_VSETIVLI | vtype << 20 | avl << 15 | rd << 7;
+}
+static uint32_t vsetvl(unsigned rd, unsigned rs1, unsigned rs2)
+{
+  return MATCH_VSETVL | rs2 << 20 | rs1 << 15 | rd << 7;
+}
+
+static uint64_t csr(spike_t* s, unsigned which)
+{
+  uint64_t x = 0;
+  CHECK(spike_get_csr(s, 0, which, &x) == 0, "csr %x doesn't exist", which);
+  return x;
+}
+
+static uint64_t xreg(spike_t* s, unsigned reg)
+{
+  uint64_t x = 0;
+  CHECK(spike_get_xreg(s, 0, reg, &x) == 0, "x%u doesn't exist", reg);
+  return x;
+}
+
+// run one instruction; false if it trapped
+static bool run(spike_t* s, uint32_t insn)
+{
+  uint64_t base = spike_mem_base(s), pc = 0;
+  spike_write_mem(s, base, 4, &insn);
+  spike_set_pc(s, 0, base);
+  spike_step_hart(s, 0, 1);
+  spike_get_pc(s, 0, &pc);
+  return pc == base + 4;
+}
+
+// vl and vtype after setting vtype with the given avl, from the spec
+static void expect(uint64_t vlenb, uint64_t vtype, uint64_t avl,
+                   uint64_t* vl, uint64_t* new_vtype, uint64_t* vlmax)
+{
+  uint64_t sew = 8 << ((vtype >> 3) & 7);
+  int lmul = vtype & 7;
+  lmul = lmul >= 4 ? lmul - 8 : lmul;
+  bool legal = (vtype >> 3 & 7) <= 3 && lmul != -4 && (vtype >> 8) == 0 &&
+               (lmul >= 0 || sew <= ELEN >> -lmul);
+  *vlmax = !legal ? 0 : lmul >= 0 ? (vlenb * 8 << lmul) / sew
+                                  : (vlenb * 8 >> -lmul) / sew;
+  *vl = avl < *vlmax ? avl : *vlmax;
+  *new_vtype = legal ? vtype : VILL;
+}
+
+static void check_state(spike_t* s, const char* what, uint64_t vtype,
+                        uint64_t vl, uint64_t new_vtype)
+{
+  CHECK(csr(s, CSR_VL) == vl && csr(s, CSR_VTYPE) == new_vtype,
+        "%s vtype %" PRIx64 ": vl %" PRIu64 " vtype %" PRIx64 ", want %" PRIu64
+        " %" PRIx64, what, vtype, csr(s, CSR_VL), csr(s, CSR_VTYPE), vl, new_vtype);
+}
+
+static void test_vset(spike_t* s)
+{
+  uint64_t vlenb = csr(s, CSR_VLENB);
+  CHECK(vlenb >= 16 && (vlenb & (vlenb - 1)) == 0, "vlenb is %" PRIu64, vlenb);
+
+  // every vsew and vlmul, the tail and mask policy bits and a reserved bit
+  for (uint64_t vtype = 0; vtype < 0x200; vtype += vtype < 0xc0 ? 1 : 0x40) {
+    for (uint64_t avl : {0, 1, 3, 5, 17, 100, 1000}) {
+      uint64_t vl, new_vtype, vlmax;
+      expect(vlenb, vtype, avl, &vl, &new_vtype, &vlmax);
+
+      spike_set_xreg(s, 0, 6, avl);
+      CHECK(run(s, vsetvli(5, 6, vtype)), "vsetvli trapped");
+      CHECK(xreg(s, 5) == vl, "vsetvli wrote %" PRIu64, xreg(s, 5));
+      check_state(s, "vsetvli", vtype, vl, new_vtype);
+
+      spike_set_xreg(s, 0, 7, vtype);
+      CHECK(run(s, vsetvl(5, 6, 7)), "vsetvl trapped");
+      check_state(s, "vsetvl", vtype, vl, new_vtype);
+
+      if (avl < 32 && vtype < 0x100) {
+        CHECK(run(s, vsetivli(5, avl, vtype)), "vsetivli trapped");
+        check_state(s, "vsetivli", vtype, vl, new_vtype);
+      }
+
+      // rs1 = x0 and rd != x0 asks for vlmax
+      CHECK(run(s, vsetvli(5, 0, vtype)), "vsetvli trapped");
+      check_state(s, "vsetvli x0", vtype, vlmax, new_vtype);
+    }
+  }
+
+  // a vtype with vill set is itself illegal
+  spike_set_xreg(s, 0, 7, VILL);
+  CHECK(run(s, vsetvl(5, 6, 7)), "vsetvl trapped");
+  check_state(s, "vsetvl", VILL, 0, VILL);
+
+  // rd = rs1 = x0 keeps vl, but only if vlmax doesn't change
+  const uint64_t e32m1 = 2 << 3, e16mf2 = 1 << 3 | 7, e16m1 = 1 << 3;
+  spike_set_xreg(s, 0, 6, 3);
+  run(s, vsetvli(5, 6, e32m1));
+  CHECK(run(s, vsetvli(0, 0, e16mf2)), "vsetvli trapped");
+  check_state(s, "keeping vl", e16mf2, 3, e16mf2);
+  CHECK(run(s, vsetvli(0, 0, e16m1)), "vsetvli trapped");
+  check_state(s, "changing vlmax", e16m1, 0, VILL);
+  CHECK(run(s, vsetvli(0, 0, e16m1)), "vsetvli trapped");
+  check_state(s, "keeping vl after vill", e16m1, 0, VILL);
+}
+
+int main()
+{
+  spike_t* s = spike_new("RV64IMAFDCXVSUBSET", 1, 16);
+  CHECK(spike_set_csr(s, 0, CSR_MSTATUS, csr(s, CSR_MSTATUS) | MSTATUS_FS) == 0,
+        "can't enable the FPU");
+  test_vset(s);
+  // the subset isn't the whole V extension
+  CHECK(!(csr(s, CSR_MISA) & (1 << ('V' - 'A'))), "misa.V is set");
+  spike_delete(s);
+
+  s = spike_new("RV64IMAFDC", 1, 16);
+  CHECK(!run(s, vsetvli(5, 6, 0)) && csr(s, CSR_MCAUSE) == CAUSE_ILLEGAL_INSTRUCTION,
+        "vsetvli is legal without the vector subset");
+  uint64_t vl;
+  CHECK(spike_get_csr(s, 0, CSR_VL, &vl) != 0, "vl exists without the vector subset");
+
+  uint64_t x = 0;
+  CHECK(spike_get_xreg(s, 1, 5, &x) != 0 && spike_set_pc(s, 1, 0) != 0 &&
+        spike_step_hart(s, 1, 1) != 0 && spike_get_csr(s, 1, CSR_VL, &x) != 0,
+        "hart 1 exists");
+  CHECK(spike_get_xreg(s, 0, 32, &x) != 0 && spike_set_xreg(s, 0, 32, 0) != 0 &&
+        spike_get_freg(s, 0, 32, &x) != 0 && spike_set_freg(s, 0, 32, 0) != 0,
+        "register 32 exists");
+  spike_delete(s);
+
+  for (const char* isa : {"RV64Q", "RV64IMAFDCQ", "RV64IDC", "RV32E"})
+    CHECK(!spike_new(isa, 1, 16), "%s is accepted", isa);
+
+  puts(failures ? "FAILED" : "PASSED");
+  return failures != 0;
+}